@@ -0,0 +1,158 @@
+#include "AssetWatcher.h"
+
+#include <algorithm>
+
+#ifndef _WIN32
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#endif
+
+
+#ifndef _WIN32
+static std::string directoryOf(const std::string& path)
+{
+	std::size_t slash = path.find_last_of('/');
+	return slash == std::string::npos ? std::string("./") : path.substr(0, slash + 1);
+}
+#else
+static std::time_t modificationTime(const std::string& path)
+{
+	struct _stat info;
+	return _stat(path.c_str(), &info) == 0 ? info.st_mtime : 0;
+}
+#endif
+
+
+//CONSTRUCTOR
+//============
+#ifndef _WIN32
+AssetWatcher::AssetWatcher()
+	: inotify(inotify_init1(IN_NONBLOCK | IN_CLOEXEC))
+{
+}
+
+AssetWatcher::~AssetWatcher()
+{
+	if (inotify >= 0)
+	{
+		close(inotify);		// drops every watch with it
+	}
+}
+#else
+AssetWatcher::AssetWatcher()
+	: lastPoll(std::chrono::steady_clock::now())
+{
+}
+
+AssetWatcher::~AssetWatcher()
+{
+}
+#endif
+
+
+
+// FUNCTIONS
+//==========
+#ifndef _WIN32
+// inotify hands back the same descriptor for a directory that is already watched
+void AssetWatcher::watch(const std::string& path)
+{
+	if (inotify < 0 || std::find(paths.begin(), paths.end(), path) != paths.end())
+	{
+		return;
+	}
+	paths.push_back(path);
+
+	std::string directory = directoryOf(path);
+	int descriptor = inotify_add_watch(inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+	if (descriptor >= 0)
+	{
+		directories[descriptor] = directory;
+	}
+}
+
+void AssetWatcher::poll(std::vector<std::string>& changed)
+{
+	changed.clear();
+	if (inotify < 0)
+	{
+		return;
+	}
+
+	alignas(inotify_event) char buffer[4096];
+	for (;;)
+	{
+		ssize_t length = read(inotify, buffer, sizeof(buffer));
+		if (length <= 0)
+		{
+			break;		// EAGAIN: nothing more has happened
+		}
+
+		for (ssize_t at = 0; at < length; )
+		{
+			const inotify_event* event = (const inotify_event*)(buffer + at);
+			at += sizeof(inotify_event) + event->len;
+
+			std::map<int, std::string>::const_iterator directory = directories.find(event->wd);
+			if (directory == directories.end() || event->len == 0)
+			{
+				continue;
+			}
+			std::string path = directory->second + event->name;
+			if (std::find(paths.begin(), paths.end(), path) != paths.end() && std::find(changed.begin(), changed.end(), path) == changed.end())
+			{
+				changed.push_back(path);	// one save can be several events
+			}
+		}
+	}
+}
+
+bool AssetWatcher::isWatching() const
+{
+	return inotify >= 0;
+}
+#else
+void AssetWatcher::watch(const std::string& path)
+{
+	if (std::find(paths.begin(), paths.end(), path) != paths.end())
+	{
+		return;
+	}
+	paths.push_back(path);
+	modified.push_back(modificationTime(path));
+}
+
+// a stat per file is cheap, but not every frame
+void AssetWatcher::poll(std::vector<std::string>& changed)
+{
+	changed.clear();
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (now - lastPoll < std::chrono::milliseconds(250))
+	{
+		return;
+	}
+	lastPoll = now;
+
+	for (std::size_t i = 0; i < paths.size(); ++i)
+	{
+		std::time_t time = modificationTime(paths[i]);
+		if (time != modified[i])
+		{
+			modified[i] = time;
+			if (time != 0)
+			{
+				changed.push_back(paths[i]);
+			}
+		}
+	}
+}
+
+bool AssetWatcher::isWatching() const
+{
+	return true;
+}
+#endif
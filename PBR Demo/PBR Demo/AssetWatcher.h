@@ -0,0 +1,44 @@
+#ifndef ASSETWATCHER_H
+#define ASSETWATCHER_H
+
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <map>
+#else
+#include <chrono>
+#include <ctime>
+#endif
+
+
+// Reports files that have been rewritten since the last poll(), for hot reloading. On Linux each
+// watched file's directory gets an inotify watch, so poll() is one non-blocking read that usually
+// finds nothing; editors that save through a temporary file and a rename are caught too. Elsewhere
+// the files' modification times are compared, at most a few times a second.
+class AssetWatcher
+{
+public:
+	AssetWatcher();
+	~AssetWatcher();
+
+	void watch(const std::string& path);
+	void poll(std::vector<std::string>& changed);	// replaces changed with the paths, as given to watch(), written since the last poll
+
+	bool isWatching() const;	// false if the platform's watch could not be set up
+
+private:
+	AssetWatcher(const AssetWatcher&);				// not copyable, the destructor closes the watch
+	AssetWatcher& operator=(const AssetWatcher&);
+
+	std::vector<std::string> paths;
+
+#ifndef _WIN32
+	int inotify;
+	std::map<int, std::string> directories;			// watch descriptor -> directory, with its trailing '/'
+#else
+	std::vector<std::time_t> modified;				// per path, 0 while it doesn't exist
+	std::chrono::steady_clock::time_point lastPoll;
+#endif
+};
+#endif
@@ -0,0 +1,21 @@
+#ifndef FRAMEUNIFORMS_H
+#define FRAMEUNIFORMS_H
+
+#include <glm/glm.hpp>
+
+
+// uniform block binding shared by every program that declares FrameData
+const unsigned int frameUniformBinding = 0;
+
+// CPU side of the FrameData block, laid out to std140 rules: every member is vec4 aligned.
+// the lights themselves live in texture buffers, see LightClusters.h
+struct FrameUniforms
+{
+	glm::mat4 projection;
+	glm::mat4 view;
+	glm::vec4 viewPos;
+	glm::uvec4 clusterGrid;		// tiles x, tiles y, depth slices, light count
+	glm::vec4 clusterScale;		// tiles per pixel x and y, depth slice scale and bias
+	glm::mat4 inverseViewProjection;	// clip space back to world space, for positions rebuilt from depth
+};
+#endif
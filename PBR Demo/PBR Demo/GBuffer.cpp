@@ -0,0 +1,86 @@
+#include "GBuffer.h"
+
+#include <iostream>
+
+
+//CONSTRUCTOR
+//============
+GBuffer::GBuffer()
+	: width(0), height(0), targetFramebuffer(0)
+{
+	glGenFramebuffers(1, &fbo);
+	glGenTextures(3, textures);
+}
+
+GBuffer::~GBuffer()
+{
+	glDeleteTextures(3, textures);
+	glDeleteFramebuffers(1, &fbo);
+}
+
+
+
+// FUNCTIONS
+//==========
+void GBuffer::begin()
+{
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	if (viewport[2] != width || viewport[3] != height)
+	{
+		allocate(viewport[2], viewport[3]);
+	}
+
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &targetFramebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void GBuffer::end()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+}
+
+void GBuffer::bind(unsigned int firstUnit) const
+{
+	for (int i = 0; i < 3; ++i)
+	{
+		glActiveTexture(GL_TEXTURE0 + firstUnit + i);
+		glBindTexture(GL_TEXTURE_2D, textures[i]);
+	}
+}
+
+void GBuffer::allocate(int newWidth, int newHeight)
+{
+	width = newWidth;
+	height = newHeight;
+
+	const GLenum internalFormats[3] = { GL_RGBA8, GL_RGBA16, GL_DEPTH_COMPONENT24 };
+	const GLenum formats[3] = { GL_RGBA, GL_RGBA, GL_DEPTH_COMPONENT };
+	const GLenum types[3] = { GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT, GL_UNSIGNED_INT };
+	for (int i = 0; i < 3; ++i)
+	{
+		glBindTexture(GL_TEXTURE_2D, textures[i]);
+		glTexImage2D(GL_TEXTURE_2D, 0, internalFormats[i], width, height, 0, formats[i], types[i], NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);	// read back one texel per pixel
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	GLint previousFramebuffer;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[0], 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, textures[1], 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, textures[2], 0);
+	const GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glDrawBuffers(2, drawBuffers);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "G-buffer framebuffer is not complete" << std::endl;
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+}
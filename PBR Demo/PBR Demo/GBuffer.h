@@ -0,0 +1,30 @@
+#ifndef GBUFFER_H
+#define GBUFFER_H
+
+#include <glad/glad.h>
+
+
+// Render target of the deferred path's geometry pass, 16 bytes a pixel:
+//	albedoAO		RGBA8			albedo as it is stored in the texture, ambient occlusion
+//	normalMaterial	RGBA16			octahedral encoded normal, roughness, metallic
+//	depth			DEPTH24			world positions are rebuilt from it in the lighting pass
+// Sized to the viewport, and reallocated when that changes.
+class GBuffer
+{
+public:
+	GBuffer();
+	~GBuffer();
+
+	void begin();	// bind and clear it, remembering the framebuffer that was being drawn into
+	void end();		// back to that framebuffer for the lighting pass
+	void bind(unsigned int firstUnit) const;	// albedoAO, normalMaterial, depth on three units
+
+private:
+	int width, height;
+	unsigned int fbo;
+	unsigned int textures[3];
+	int targetFramebuffer;
+
+	void allocate(int width, int height);
+};
+#endif
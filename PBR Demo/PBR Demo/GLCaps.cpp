@@ -0,0 +1,101 @@
+#include "GLCaps.h"
+
+#include <cstring>
+
+
+GLCaps glCaps;
+
+#ifndef GL_VERSION_4_4
+PFNGLBUFFERSTORAGEPROC glad_glBufferStorage = NULL;
+#endif
+#ifndef GL_VERSION_4_1
+PFNGLGETPROGRAMBINARYPROC glad_glGetProgramBinary = NULL;
+PFNGLPROGRAMBINARYPROC glad_glProgramBinary = NULL;
+PFNGLPROGRAMPARAMETERIPROC glad_glProgramParameteri = NULL;
+#endif
+#ifndef GL_KHR_parallel_shader_compile
+PFNGLMAXSHADERCOMPILERTHREADSKHRPROC glad_glMaxShaderCompilerThreadsKHR = NULL;
+#endif
+#ifndef GL_VERSION_4_3
+PFNGLMULTIDRAWELEMENTSINDIRECTPROC glad_glMultiDrawElementsIndirect = NULL;
+#endif
+#ifndef GL_ARB_bindless_texture
+PFNGLGETTEXTUREHANDLEARBPROC glad_glGetTextureHandleARB = NULL;
+PFNGLMAKETEXTUREHANDLERESIDENTARBPROC glad_glMakeTextureHandleResidentARB = NULL;
+PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC glad_glMakeTextureHandleNonResidentARB = NULL;
+#endif
+
+
+// FUNCTIONS
+//==========
+bool GLCaps::atLeast(int major, int minor) const
+{
+	return majorVersion > major || (majorVersion == major && minorVersion >= minor);
+}
+
+// extension names are matched whole, so "GL_ARB_foo" does not match "GL_ARB_foo_bar"
+bool GLCaps::hasExtension(const char* name) const
+{
+	std::string padded = std::string(" ") + name + " ";
+	return extensions.find(padded) != std::string::npos;
+}
+
+void loadGLCaps(GLADloadproc load)
+{
+	glCaps.majorVersion = GLVersion.major;
+	glCaps.minorVersion = GLVersion.minor;
+
+	// core profiles only expose the extension list one string at a time
+	int extensionCount = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+	glCaps.extensions = " ";
+	for (int i = 0; i < extensionCount; ++i)
+	{
+		glCaps.extensions += (const char*)glGetStringi(GL_EXTENSIONS, i);
+		glCaps.extensions += " ";
+	}
+
+	// buffer storage
+	glad_glBufferStorage = (PFNGLBUFFERSTORAGEPROC)load("glBufferStorage");
+	glCaps.bufferStorage = glad_glBufferStorage != NULL && (glCaps.atLeast(4, 4) || glCaps.hasExtension("GL_ARB_buffer_storage"));
+
+	// program binaries, a driver can support the entry points and still offer no format to save in
+	glad_glGetProgramBinary = (PFNGLGETPROGRAMBINARYPROC)load("glGetProgramBinary");
+	glad_glProgramBinary = (PFNGLPROGRAMBINARYPROC)load("glProgramBinary");
+	glad_glProgramParameteri = (PFNGLPROGRAMPARAMETERIPROC)load("glProgramParameteri");
+	glCaps.programBinary = glad_glGetProgramBinary != NULL && glad_glProgramBinary != NULL && glad_glProgramParameteri != NULL
+		&& (glCaps.atLeast(4, 1) || glCaps.hasExtension("GL_ARB_get_program_binary"));
+	if (glCaps.programBinary)
+	{
+		int formatCount = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+		glCaps.programBinary = formatCount > 0;
+	}
+
+	// parallel shader compile, the ARB version came first under another name
+	glad_glMaxShaderCompilerThreadsKHR = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)load("glMaxShaderCompilerThreadsKHR");
+	if (glad_glMaxShaderCompilerThreadsKHR == NULL)
+	{
+		glad_glMaxShaderCompilerThreadsKHR = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)load("glMaxShaderCompilerThreadsARB");
+	}
+	glCaps.parallelShaderCompile = glad_glMaxShaderCompilerThreadsKHR != NULL
+		&& (glCaps.hasExtension("GL_KHR_parallel_shader_compile") || glCaps.hasExtension("GL_ARB_parallel_shader_compile"));
+
+	// multi-draw indirect
+	glad_glMultiDrawElementsIndirect = (PFNGLMULTIDRAWELEMENTSINDIRECTPROC)load("glMultiDrawElementsIndirect");
+	bool baseInstance = glCaps.atLeast(4, 2) || glCaps.hasExtension("GL_ARB_base_instance");
+	glCaps.multiDrawIndirect = glad_glMultiDrawElementsIndirect != NULL && baseInstance && (glCaps.atLeast(4, 3) || glCaps.hasExtension("GL_ARB_multi_draw_indirect"));
+
+	// bindless textures
+	glad_glGetTextureHandleARB = (PFNGLGETTEXTUREHANDLEARBPROC)load("glGetTextureHandleARB");
+	glad_glMakeTextureHandleResidentARB = (PFNGLMAKETEXTUREHANDLERESIDENTARBPROC)load("glMakeTextureHandleResidentARB");
+	glad_glMakeTextureHandleNonResidentARB = (PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC)load("glMakeTextureHandleNonResidentARB");
+	glCaps.bindlessTexture = glad_glGetTextureHandleARB != NULL && glad_glMakeTextureHandleResidentARB != NULL && glad_glMakeTextureHandleNonResidentARB != NULL
+		&& glCaps.hasExtension("GL_ARB_bindless_texture");
+
+	// texture formats
+	glCaps.textureCompressionBPTC = glCaps.atLeast(4, 2) || glCaps.hasExtension("GL_ARB_texture_compression_bptc");
+
+	// queries
+	glCaps.pipelineStatistics = glCaps.atLeast(4, 6) || glCaps.hasExtension("GL_ARB_pipeline_statistics_query");
+}
@@ -0,0 +1,108 @@
+#ifndef GLCAPS_H
+#define GLCAPS_H
+
+#include <glad/glad.h>
+
+#include <string>
+
+
+// ENTRY POINTS NEWER THAN THE GLAD PROFILE
+//=========================================
+// glad was generated for a 4.0 core profile with no extensions, so anything newer is declared here
+// and loaded by loadGLCaps(). Only call these when the matching flag in glCaps is set.
+
+// GL 4.4 / ARB_buffer_storage
+#ifndef GL_VERSION_4_4
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+#define GL_CLIENT_STORAGE_BIT 0x0200
+typedef void (APIENTRYP PFNGLBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+GLAPI PFNGLBUFFERSTORAGEPROC glad_glBufferStorage;
+#define glBufferStorage glad_glBufferStorage
+#endif
+
+// GL 4.1 / ARB_get_program_binary
+#ifndef GL_VERSION_4_1
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+typedef void (APIENTRYP PFNGLGETPROGRAMBINARYPROC)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+typedef void (APIENTRYP PFNGLPROGRAMBINARYPROC)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+typedef void (APIENTRYP PFNGLPROGRAMPARAMETERIPROC)(GLuint program, GLenum pname, GLint value);
+GLAPI PFNGLGETPROGRAMBINARYPROC glad_glGetProgramBinary;
+GLAPI PFNGLPROGRAMBINARYPROC glad_glProgramBinary;
+GLAPI PFNGLPROGRAMPARAMETERIPROC glad_glProgramParameteri;
+#define glGetProgramBinary glad_glGetProgramBinary
+#define glProgramBinary glad_glProgramBinary
+#define glProgramParameteri glad_glProgramParameteri
+#endif
+
+// GL 4.3 / ARB_multi_draw_indirect, the commands' base instance also needs GL 4.2 / ARB_base_instance
+#ifndef GL_VERSION_4_3
+typedef void (APIENTRYP PFNGLMULTIDRAWELEMENTSINDIRECTPROC)(GLenum mode, GLenum type, const void* indirect, GLsizei drawcount, GLsizei stride);
+GLAPI PFNGLMULTIDRAWELEMENTSINDIRECTPROC glad_glMultiDrawElementsIndirect;
+#define glMultiDrawElementsIndirect glad_glMultiDrawElementsIndirect
+#endif
+
+// ARB_bindless_texture, never core. Textures are sampled through 64 bit handles instead of units
+#ifndef GL_ARB_bindless_texture
+typedef GLuint64 (APIENTRYP PFNGLGETTEXTUREHANDLEARBPROC)(GLuint texture);
+typedef void (APIENTRYP PFNGLMAKETEXTUREHANDLERESIDENTARBPROC)(GLuint64 handle);
+typedef void (APIENTRYP PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC)(GLuint64 handle);
+GLAPI PFNGLGETTEXTUREHANDLEARBPROC glad_glGetTextureHandleARB;
+GLAPI PFNGLMAKETEXTUREHANDLERESIDENTARBPROC glad_glMakeTextureHandleResidentARB;
+GLAPI PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC glad_glMakeTextureHandleNonResidentARB;
+#define glGetTextureHandleARB glad_glGetTextureHandleARB
+#define glMakeTextureHandleResidentARB glad_glMakeTextureHandleResidentARB
+#define glMakeTextureHandleNonResidentARB glad_glMakeTextureHandleNonResidentARB
+#endif
+
+// KHR_parallel_shader_compile / ARB_parallel_shader_compile, never core. Both share the entry point and token
+#ifndef GL_KHR_parallel_shader_compile
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+GLAPI PFNGLMAXSHADERCOMPILERTHREADSKHRPROC glad_glMaxShaderCompilerThreadsKHR;
+#define glMaxShaderCompilerThreadsKHR glad_glMaxShaderCompilerThreadsKHR
+#endif
+
+// GL 4.6 / ARB_pipeline_statistics_query, the profiler only counts fragment shader invocations
+#ifndef GL_VERSION_4_6
+#define GL_FRAGMENT_SHADER_INVOCATIONS 0x82F4
+#endif
+
+// GL 4.2 / ARB_texture_compression_bptc, BC7. RGTC (BC4/BC5) is core since 3.0 and already in glad
+#ifndef GL_VERSION_4_2
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#endif
+
+
+// CAPABILITIES
+//=============
+struct GLCaps
+{
+	int majorVersion = 0;		// version of the context we actually got, not the one we asked for
+	int minorVersion = 0;
+
+	bool bufferStorage = false;	// immutable buffers that can stay mapped (persistent mapping)
+	bool textureCompressionBPTC = false;	// BC7 textures can be sampled directly
+	bool multiDrawIndirect = false;		// many indexed draws from a buffer in one call, each with its own base instance
+	bool parallelShaderCompile = false;	// compiles and links run on driver threads and can be polled for completion
+	bool programBinary = false;			// linked programs can be saved and reloaded, the driver has at least one binary format
+	bool pipelineStatistics = false;		// pipeline statistics queries, e.g. fragment shader invocations
+	bool bindlessTexture = false;		// resident texture handles shaders can sample without binding to a unit
+
+	bool atLeast(int major, int minor) const;
+	bool hasExtension(const char* name) const;
+
+	std::string extensions;		// space separated, queried once
+};
+
+extern GLCaps glCaps;
+
+// query the context version and extensions and load the entry points above
+// must be called on the GL thread after gladLoadGLLoader
+void loadGLCaps(GLADloadproc load);
+
+#endif
@@ -0,0 +1,15 @@
+#include "Hash.h"
+
+
+// FUNCTIONS
+//==========
+std::uint64_t hashBytes(const void* data, std::size_t size, std::uint64_t hash)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (std::size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
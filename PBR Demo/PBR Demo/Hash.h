@@ -0,0 +1,11 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstddef>
+#include <cstdint>
+
+
+// FNV-1a, fold more bytes into a running hash. what the caches key their files on
+std::uint64_t hashBytes(const void* data, std::size_t size, std::uint64_t hash = 14695981039346656037ull);
+
+#endif
@@ -0,0 +1,178 @@
+#include "Headless.h"
+
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+
+//CONSTRUCTOR
+//============
+HeadlessRun::HeadlessRun(const HeadlessSettings& settings, int width, int height)
+	: settings(settings), width(width), height(height), frame(0), frameStartTime(0.0), submitTime(0.0)
+{
+	// colour and depth renderbuffers, the window's own framebuffer is never drawn to
+	glGenFramebuffers(1, &fbo);
+	glGenRenderbuffers(1, &colourRBO);
+	glGenRenderbuffers(1, &depthRBO);
+
+	glBindRenderbuffer(GL_RENDERBUFFER, colourRBO);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, depthRBO);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colourRBO);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRBO);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "Headless framebuffer is not complete" << std::endl;
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	glGenQueries(2, timerQueries);
+
+#ifdef _WIN32
+	_mkdir(settings.outputDir.c_str());
+#else
+	mkdir(settings.outputDir.c_str(), 0755);
+#endif
+	timings.reserve(settings.frameCount);
+}
+
+HeadlessRun::~HeadlessRun()
+{
+	glDeleteFramebuffers(1, &fbo);
+	glDeleteRenderbuffers(1, &colourRBO);
+	glDeleteRenderbuffers(1, &depthRBO);
+	glDeleteQueries(2, timerQueries);
+}
+
+
+
+// FUNCTIONS
+//==========
+bool HeadlessRun::done() const
+{
+	return frame >= settings.frameCount;
+}
+
+void HeadlessRun::beginFrame(Camera& camera)
+{
+	camera = cameraPathPose(frame, settings.frameCount);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glViewport(0, 0, width, height);
+
+	frameStartTime = glfwGetTime();
+	glQueryCounter(timerQueries[0], GL_TIMESTAMP);
+}
+
+void HeadlessRun::endFrame()
+{
+	glQueryCounter(timerQueries[1], GL_TIMESTAMP);
+	submitTime = glfwGetTime();
+	glFinish();
+
+	FrameTiming timing;
+	timing.cpuMs = (submitTime - frameStartTime) * 1000.0;
+	timing.frameMs = (glfwGetTime() - frameStartTime) * 1000.0;
+
+	GLuint64 gpuStart = 0, gpuEnd = 0;
+	glGetQueryObjectui64v(timerQueries[0], GL_QUERY_RESULT, &gpuStart);
+	glGetQueryObjectui64v(timerQueries[1], GL_QUERY_RESULT, &gpuEnd);
+	timing.gpuMs = (gpuEnd - gpuStart) / 1000000.0;
+	timings.push_back(timing);
+
+	if (settings.dumpEvery > 0 && frame % settings.dumpEvery == 0)
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "/frame_%04d.ppm", frame);
+		writeFrame(settings.outputDir + name);
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	++frame;
+}
+
+void HeadlessRun::finish()
+{
+	std::string path = settings.outputDir + "/timings.csv";
+	std::ofstream csv(path.c_str());
+	csv << "frame,cpu_ms,frame_ms,gpu_ms\n";
+	for (std::size_t i = 0; i < timings.size(); ++i)
+	{
+		csv << i << "," << timings[i].cpuMs << "," << timings[i].frameMs << "," << timings[i].gpuMs << "\n";
+	}
+	if (!csv.good())
+	{
+		std::cout << "Failed to write " << path << std::endl;
+	}
+
+	if (timings.empty())
+	{
+		return;
+	}
+
+	// the first frame pays for shader warm-up and texture residency, keep it out of the summary when there are others
+	std::size_t first = timings.size() > 1 ? 1 : 0;
+	double total = 0.0, gpuTotal = 0.0;
+	double fastest = timings[first].frameMs, slowest = timings[first].frameMs;
+	for (std::size_t i = first; i < timings.size(); ++i)
+	{
+		total += timings[i].frameMs;
+		gpuTotal += timings[i].gpuMs;
+		fastest = std::min(fastest, timings[i].frameMs);
+		slowest = std::max(slowest, timings[i].frameMs);
+	}
+	std::size_t count = timings.size() - first;
+	std::cout << "Headless: " << timings.size() << " frames, " << total / count << " ms average (" << fastest << " min, " << slowest << " max), "
+		<< gpuTotal / count << " ms GPU average" << std::endl;
+}
+
+// binary PPM, rows flipped so the image is the right way up
+void HeadlessRun::writeFrame(const std::string& path)
+{
+	std::vector<unsigned char> pixels((std::size_t)width * height * 3);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+	glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, &pixels[0]);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+	std::ofstream file(path.c_str(), std::ios::binary);
+	file << "P6\n" << width << " " << height << "\n255\n";
+	for (int y = height - 1; y >= 0; --y)
+	{
+		file.write((const char*)&pixels[(std::size_t)y * width * 3], width * 3);
+	}
+	if (!file.good())
+	{
+		std::cout << "Failed to write " << path << std::endl;
+	}
+}
+
+Camera cameraPathPose(int frame, int frameCount)
+{
+	const glm::vec3 target(0.0f, 0.0f, 0.0f);
+	const float radius = 8.0f;
+
+	float t = (float)frame / (float)std::max(frameCount, 1);
+	float angle = t * 2.0f * 3.14159265359f;
+	glm::vec3 position(radius * sin(angle), 1.5f * sin(2.0f * angle), radius * cos(angle));
+
+	// the camera is driven by euler angles, so turn the look direction into yaw and pitch
+	glm::vec3 direction = glm::normalize(target - position);
+	float yaw = glm::degrees(atan2(direction.z, direction.x));
+	float pitch = glm::degrees(asin(direction.y));
+
+	return Camera(position, glm::vec3(0.0f, 1.0f, 0.0f), yaw, pitch);
+}
@@ -0,0 +1,61 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <glad/glad.h>
+
+#include <Camera.h>
+
+#include <string>
+#include <vector>
+
+
+// options for --headless
+struct HeadlessSettings
+{
+	int frameCount = 120;					// --frames N
+	int dumpEvery = 30;						// --dump-every N, write every Nth frame as a PPM (0 = none)
+	std::string outputDir = "headless";		// --output DIR, frames and timings.csv go here
+};
+
+// Drives the render loop without a visible window: every frame is rendered into an offscreen
+// framebuffer from a fixed camera path, so runs are reproducible and their images can be diffed.
+// Meant for GLFW built with GLFW_USE_OSMESA on machines without a GPU, but works with any backend.
+class HeadlessRun
+{
+public:
+	HeadlessRun(const HeadlessSettings& settings, int width, int height);
+	~HeadlessRun();
+
+	bool done() const;
+
+	void beginFrame(Camera& camera);	// poses the camera, binds the offscreen target and starts the timers
+	void endFrame();					// waits for the GPU, records the frame's timings and dumps it if due
+	void finish();						// writes timings.csv and prints a summary
+
+private:
+	HeadlessSettings settings;
+	int width, height;
+	int frame;
+
+	// render target
+	unsigned int fbo, colourRBO, depthRBO;
+
+	// timing, the GPU is drained every frame so the queries are always ready. timestamps rather
+	// than GL_TIME_ELAPSED, which can't nest and is left to the profiler's passes
+	unsigned int timerQueries[2];
+	double frameStartTime;
+	double submitTime;
+	struct FrameTiming
+	{
+		double cpuMs;		// recording and submitting commands
+		double frameMs;		// until the GPU finished the frame
+		double gpuMs;		// between GPU timestamps at the start and end of the frame
+	};
+	std::vector<FrameTiming> timings;
+
+	void writeFrame(const std::string& path);
+};
+
+// camera pose at frame of frameCount: one orbit around the sphere row, bobbing up and down
+Camera cameraPathPose(int frame, int frameCount);
+#endif
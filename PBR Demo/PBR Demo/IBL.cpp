@@ -0,0 +1,271 @@
+#include "IBL.h"
+#include "Primitives.h"
+#include "Hash.h"
+#include "IBLCache.h"
+#include "MappedFile.h"
+#include "Profiler.h"
+#include "ShaderSource.h"
+
+#include <GLFW/glfw3.h>
+#include <stb_image.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <iostream>
+
+
+// bake shaders, their sources and everything they include are part of the cache hash
+static const char* const equirectangularShaderPaths[2] = { "PBR Project/PBR Demo/Shaders/vs_PBR-IBL.glsl", "PBR Project/PBR Demo/Shaders/fs_PBR-IBL.glsl" };
+static const char* const irradianceShaderPaths[2] = { "PBR Project/PBR Demo/Shaders/vs_PBR-IBL.glsl", "PBR Project/PBR Demo/Shaders/fs_PBR-Irradiance.glsl" };
+static const char* const prefilterShaderPaths[2] = { "PBR Project/PBR Demo/Shaders/vs_PBR-IBL.glsl", "PBR Project/PBR Demo/Shaders/fs_PBR-Prefilter.glsl" };
+static const char* const brdfShaderPaths[2] = { "PBR Project/PBR Demo/Shaders/vs_PBR-BRDF.glsl", "PBR Project/PBR Demo/Shaders/fs_PBR-BRDF.glsl" };
+
+//CONSTRUCTOR
+//============
+IBLBaker::IBLBaker(const IBLSettings& settings)
+	: settings(settings),
+	shader_equirectangularToCubemap(equirectangularShaderPaths[0], equirectangularShaderPaths[1]),
+	shader_irradiance(irradianceShaderPaths[0], irradianceShaderPaths[1]),
+	shader_prefilter(prefilterShaderPaths[0], prefilterShaderPaths[1]),
+	shader_brdf(brdfShaderPaths[0], brdfShaderPaths[1])
+{
+	//framebuffers
+	glGenFramebuffers(1, &captureFBO);
+	glGenRenderbuffers(1, &captureRBO);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
+	glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, settings.environmentSize, settings.environmentSize);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, captureRBO);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	// projection/view matrices
+	captureProjection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 10.0f);
+	captureViews[0] = glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f));
+	captureViews[1] = glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f));
+	captureViews[2] = glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+	captureViews[3] = glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f));
+	captureViews[4] = glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, -1.0f, 0.0f));
+	captureViews[5] = glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, -1.0f, 0.0f));
+}
+
+// the baked maps outlive the baker, everything used to make them does not
+IBLBaker::~IBLBaker()
+{
+	shader_equirectangularToCubemap.stopUsing();
+	shader_irradiance.stopUsing();
+	shader_prefilter.stopUsing();
+	shader_brdf.stopUsing();
+
+	glDeleteFramebuffers(1, &captureFBO);
+	glDeleteRenderbuffers(1, &captureRBO);
+}
+
+
+
+// FUNCTIONS
+//==========
+// everything the bake output depends on: the HDR, the bake shaders and the settings. 0 if the HDR can't be read
+static std::uint64_t hashIBLInputs(const char* hdrPath, const IBLSettings& settings)
+{
+	MappedFile hdr(hdrPath);
+	if (!hdr.isOpen())
+	{
+		return 0;
+	}
+	std::uint64_t hash = hashBytes(hdr.data(), hdr.size());
+
+	const char* const shaderPaths[] =
+	{
+		equirectangularShaderPaths[0], equirectangularShaderPaths[1], irradianceShaderPaths[1], prefilterShaderPaths[1],
+		brdfShaderPaths[0], brdfShaderPaths[1]
+	};
+	for (std::size_t i = 0; i < sizeof(shaderPaths) / sizeof(shaderPaths[0]); ++i)
+	{
+		ShaderSource shader;
+		if (loadShaderSource(shaderPaths[i], shader))
+		{
+			hash = hashBytes(shader.code.data(), shader.code.size(), hash);
+		}
+	}
+
+	const int values[] =
+	{
+		settings.environmentSize, settings.irradianceSize, settings.prefilterSize, settings.prefilterMipCount, settings.brdfLUTSize,
+		settings.irradianceSampleCount, settings.prefilterSampleCount, settings.brdfSampleCount
+	};
+	return hashBytes(values, sizeof(values), hash);
+}
+
+IBLMaps loadIBL(const char* hdrPath, const IBLSettings& settings)
+{
+	double startTime = glfwGetTime();
+	std::string cachePath = iblCachePath(hdrPath);
+	std::uint64_t hash = hashIBLInputs(hdrPath, settings);
+
+	IBLMaps maps;
+	if (hash != 0 && loadIBLCache(cachePath, hash, maps))
+	{
+		std::cout << "IBL loaded from " << cachePath << " in " << (glfwGetTime() - startTime) * 1000.0 << " ms" << std::endl;
+		return maps;
+	}
+
+	IBLBaker baker(settings);
+	maps = baker.bake(hdrPath);
+	if (hash != 0 && !saveIBLCache(cachePath, hash, maps, settings))
+	{
+		std::cout << "Failed to write IBL cache: " << cachePath << std::endl;
+	}
+	std::cout << "IBL baked in " << (glfwGetTime() - startTime) * 1000.0 << " ms" << std::endl;
+	return maps;
+}
+
+void deleteIBLMaps(IBLMaps& maps)
+{
+	unsigned int textures[4] = { maps.envCubemap, maps.irradianceMap, maps.prefilterMap, maps.brdfLUT };
+	glDeleteTextures(4, textures);
+	maps = IBLMaps();
+}
+
+IBLMaps IBLBaker::bake(const char* hdrPath)
+{
+	IBLMaps maps;
+
+	// hdr
+	profiler.beginScope("IBL HDR load");
+	stbi_set_flip_vertically_on_load(true);
+	int width, height, nrComponents;
+	float* data = stbi_loadf(hdrPath, &width, &height, &nrComponents, 0);
+	unsigned int hdrTexture = 0;
+	if (data)
+	{
+		glGenTextures(1, &hdrTexture);
+		glBindTexture(GL_TEXTURE_2D, hdrTexture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, width, height, 0, GL_RGB, GL_FLOAT, data);
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+		stbi_image_free(data);
+	}
+	else
+	{
+		std::cout << "Failed to load HDR image." << std::endl;
+	}
+	profiler.endScope();
+
+	// convert HDR equirectangular environment map to cubemap equivalent. the environment gets a full
+	// mip chain so the convolutions can read pre-blurred texels where their samples are sparse
+	profiler.beginScope("IBL equirect to cubemap");
+	maps.envCubemap = createCubemap(settings.environmentSize, true);
+	shader_equirectangularToCubemap.use();
+	shader_equirectangularToCubemap.setInt("equirectangularMap", 0);
+	shader_equirectangularToCubemap.setMat4("projection", captureProjection);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, hdrTexture);
+	renderToCubemap(shader_equirectangularToCubemap, maps.envCubemap, settings.environmentSize, 0);
+
+	glBindTexture(GL_TEXTURE_CUBE_MAP, maps.envCubemap);
+	glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+	glDeleteTextures(1, &hdrTexture);
+	profiler.endScope();
+
+	// diffuse irradiance
+	profiler.beginScope("IBL irradiance");
+	maps.irradianceMap = createCubemap(settings.irradianceSize, false);
+	shader_irradiance.use();
+	shader_irradiance.setInt("environmentMap", 0);
+	shader_irradiance.setMat4("projection", captureProjection);
+	shader_irradiance.setInt("sampleCount", settings.irradianceSampleCount);
+	shader_irradiance.setFloat("resolution", (float)settings.environmentSize);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, maps.envCubemap);
+	renderToCubemap(shader_irradiance, maps.irradianceMap, settings.irradianceSize, 0);
+	profiler.endScope();
+
+	// specular prefilter, roughness increases with each mip
+	profiler.beginScope("IBL specular prefilter");
+	maps.prefilterMap = createCubemap(settings.prefilterSize, true);
+	shader_prefilter.use();
+	shader_prefilter.setInt("environmentMap", 0);
+	shader_prefilter.setMat4("projection", captureProjection);
+	shader_prefilter.setInt("sampleCount", settings.prefilterSampleCount);
+	shader_prefilter.setFloat("resolution", (float)settings.environmentSize);
+	for (int mip = 0; mip < settings.prefilterMipCount; ++mip)
+	{
+		shader_prefilter.use();
+		shader_prefilter.setFloat("roughness", (float)mip / (float)(settings.prefilterMipCount - 1));
+		renderToCubemap(shader_prefilter, maps.prefilterMap, settings.prefilterSize, mip);
+	}
+	glBindTexture(GL_TEXTURE_CUBE_MAP, maps.prefilterMap);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, settings.prefilterMipCount - 1);
+	profiler.endScope();
+
+	// split sum BRDF lookup table
+	profiler.beginScope("IBL BRDF LUT");
+	glGenTextures(1, &maps.brdfLUT);
+	glBindTexture(GL_TEXTURE_2D, maps.brdfLUT);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, settings.brdfLUTSize, settings.brdfLUTSize, 0, GL_RG, GL_FLOAT, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
+	glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, settings.brdfLUTSize, settings.brdfLUTSize);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, maps.brdfLUT, 0);
+	glViewport(0, 0, settings.brdfLUTSize, settings.brdfLUTSize);
+	shader_brdf.use();
+	shader_brdf.setInt("sampleCount", settings.brdfSampleCount);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	renderQuad();
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	profiler.endScope();
+
+	// the GPU timings are read back with the frame's, a bake from a hot reload shows up in the --profile summary
+	return maps;
+}
+
+unsigned int IBLBaker::createCubemap(int size, bool mipmapped)
+{
+	unsigned int cubemap;
+	glGenTextures(1, &cubemap);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, cubemap);
+	for (unsigned int i = 0; i < 6; ++i)
+	{
+		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, size, size, 0, GL_RGB, GL_FLOAT, nullptr);
+	}
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, mipmapped ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	if (mipmapped)
+	{
+		glGenerateMipmap(GL_TEXTURE_CUBE_MAP);	// allocates the chain, the passes fill it
+	}
+	return cubemap;
+}
+
+// render the unit cube into each face of one mip of a cubemap with the shader's current settings
+void IBLBaker::renderToCubemap(Shader& shader, unsigned int cubemap, int size, int mip)
+{
+	int mipSize = size >> mip;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
+	glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, mipSize, mipSize);
+	glViewport(0, 0, mipSize, mipSize); // configure the viewport to the capture dimensions.
+
+	for (unsigned int i = 0; i < 6; ++i)
+	{
+		shader.setMat4("view", captureViews[i]);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, cubemap, mip);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		renderCube(); // renders a 1x1 cube
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
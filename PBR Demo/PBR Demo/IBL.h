@@ -0,0 +1,65 @@
+#ifndef IBL_H
+#define IBL_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <Shader.h>
+
+
+// sizes and sample counts for the image based lighting precompute
+struct IBLSettings
+{
+	int environmentSize = 512;			// per cubemap face
+	int irradianceSize = 32;
+	int prefilterSize = 128;
+	int prefilterMipCount = 5;			// roughness 0 to 1 spread over these mips
+	int brdfLUTSize = 512;
+
+	int irradianceSampleCount = 1024;	// cosine weighted
+	int prefilterSampleCount = 1024;	// GGX importance sampled, per texel per mip
+	int brdfSampleCount = 1024;
+};
+
+// everything fs_PBR needs for image based lighting
+struct IBLMaps
+{
+	unsigned int envCubemap = 0;		// the HDR environment itself, also drawn as the skybox
+	unsigned int irradianceMap = 0;		// diffuse: cosine convolved environment
+	unsigned int prefilterMap = 0;		// specular: environment convolved with GGX, one roughness per mip
+	unsigned int brdfLUT = 0;			// split sum scale and bias for F0 by (NdotV, roughness)
+};
+
+// Runs the image based lighting precompute once at startup: equirectangular HDR -> environment cubemap,
+// then the irradiance convolution, the prefiltered specular mip chain and the BRDF lookup table,
+// printing how long the CPU and GPU spent on each pass.
+class IBLBaker
+{
+public:
+	IBLBaker(const IBLSettings& settings = IBLSettings());
+	~IBLBaker();
+
+	IBLMaps bake(const char* hdrPath);
+
+private:
+	IBLSettings settings;
+
+	// every cube pass renders the unit cube once per face from the centre into captureFBO
+	unsigned int captureFBO, captureRBO;
+	glm::mat4 captureProjection;
+	glm::mat4 captureViews[6];
+
+	Shader shader_equirectangularToCubemap;
+	Shader shader_irradiance;
+	Shader shader_prefilter;
+	Shader shader_brdf;
+
+	unsigned int createCubemap(int size, bool mipmapped);
+	void renderToCubemap(Shader& shader, unsigned int cubemap, int size, int mip);
+};
+
+// the maps for an HDR environment: read from its bake cache when that is up to date,
+// otherwise baked with IBLBaker and written to the cache for next time
+IBLMaps loadIBL(const char* hdrPath, const IBLSettings& settings = IBLSettings());
+void deleteIBLMaps(IBLMaps& maps);
+#endif
@@ -0,0 +1,207 @@
+#include "IBLCache.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+
+// what saveIBLCache() writes in each slot of the table, anything else is a damaged file
+static const GLenum cacheLayouts[4][3] =
+{
+	{ GL_TEXTURE_CUBE_MAP, GL_RGB16F, GL_RGB },		// environment
+	{ GL_TEXTURE_CUBE_MAP, GL_RGB16F, GL_RGB },		// irradiance
+	{ GL_TEXTURE_CUBE_MAP, GL_RGB16F, GL_RGB },		// prefilter
+	{ GL_TEXTURE_2D, GL_RG16F, GL_RG }				// BRDF lookup
+};
+
+// bytes in one face of one mip
+static std::size_t faceSize(const IBLCacheTexture& texture, unsigned int level)
+{
+	std::size_t mipSize = std::max(1u, texture.size >> level);
+	std::size_t texelSize = (texture.format == GL_RGB ? 3 : 2) * sizeof(GLhalf);
+	return mipSize * mipSize * texelSize;
+}
+
+static std::size_t textureSize(const IBLCacheTexture& texture)
+{
+	std::size_t faces = texture.target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+	std::size_t size = 0;
+	for (unsigned int level = 0; level < texture.levelCount; ++level)
+	{
+		size += faceSize(texture, level) * faces;
+	}
+	return size;
+}
+
+// the filtering and wrapping here matches what IBLBaker sets up
+static unsigned int uploadTexture(const IBLCacheTexture& texture, const unsigned char* data)
+{
+	unsigned int textureID;
+	glGenTextures(1, &textureID);
+	glBindTexture(texture.target, textureID);
+
+	const unsigned char* pixels = data + texture.offset;
+	for (unsigned int level = 0; level < texture.levelCount; ++level)
+	{
+		int mipSize = std::max(1u, texture.size >> level);
+		if (texture.target == GL_TEXTURE_CUBE_MAP)
+		{
+			for (unsigned int i = 0; i < 6; ++i)
+			{
+				glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, level, texture.internalFormat, mipSize, mipSize, 0, texture.format, GL_HALF_FLOAT, pixels);
+				pixels += faceSize(texture, level);
+			}
+		}
+		else
+		{
+			glTexImage2D(GL_TEXTURE_2D, level, texture.internalFormat, mipSize, mipSize, 0, texture.format, GL_HALF_FLOAT, pixels);
+			pixels += faceSize(texture, level);
+		}
+	}
+
+	glTexParameteri(texture.target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(texture.target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	if (texture.target == GL_TEXTURE_CUBE_MAP)
+	{
+		glTexParameteri(texture.target, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	}
+	glTexParameteri(texture.target, GL_TEXTURE_MIN_FILTER, texture.levelCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(texture.target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(texture.target, GL_TEXTURE_MAX_LEVEL, texture.levelCount - 1);
+
+	return textureID;
+}
+
+// describe one baked map and read all of its mips back from the GPU
+static IBLCacheTexture readTexture(unsigned int textureID, GLenum target, GLenum internalFormat, GLenum format, int levelCount, std::vector<unsigned char>& data)
+{
+	IBLCacheTexture texture;
+	texture.target = target;
+	texture.internalFormat = internalFormat;
+	texture.format = format;
+	texture.levelCount = levelCount;
+	texture.padding = 0;
+	texture.offset = data.size();
+
+	GLenum faceTarget = target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X : GL_TEXTURE_2D;
+	int size = 0;
+	glBindTexture(target, textureID);
+	glGetTexLevelParameteriv(faceTarget, 0, GL_TEXTURE_WIDTH, &size);
+	texture.size = size;
+
+	data.resize(data.size() + textureSize(texture));
+	unsigned char* pixels = &data[0] + texture.offset;
+	for (int level = 0; level < levelCount; ++level)
+	{
+		int faces = target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+		for (int i = 0; i < faces; ++i)
+		{
+			glGetTexImage(faceTarget + i, level, format, GL_HALF_FLOAT, pixels);
+			pixels += faceSize(texture, level);
+		}
+	}
+	return texture;
+}
+
+
+
+// FUNCTIONS
+//==========
+std::string iblCachePath(const char* hdrPath)
+{
+	return std::string(hdrPath) + ".iblcache";
+}
+
+bool loadIBLCache(const std::string& path, std::uint64_t hash, IBLMaps& maps)
+{
+	MappedFile file(path);
+	if (!file.isOpen() || file.size() < sizeof(IBLCacheHeader))
+	{
+		return false;
+	}
+
+	const IBLCacheHeader* header = (const IBLCacheHeader*)file.data();
+	if (memcmp(header->magic, "IBLC", 4) != 0 || header->version != iblCacheVersion || header->hash != hash || header->textureCount != 4)
+	{
+		return false;
+	}
+	if (file.size() < sizeof(IBLCacheHeader) + 4 * sizeof(IBLCacheTexture))
+	{
+		return false;
+	}
+
+	// check every texture is laid out as it was saved and lies inside the file before uploading any of them.
+	// the size is bounded first so the byte counts can't overflow
+	GLint maxSize, maxCubeSize;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+	glGetIntegerv(GL_MAX_CUBE_MAP_TEXTURE_SIZE, &maxCubeSize);
+
+	const IBLCacheTexture* textures = (const IBLCacheTexture*)(file.data() + sizeof(IBLCacheHeader));
+	for (int i = 0; i < 4; ++i)
+	{
+		const IBLCacheTexture& texture = textures[i];
+		if (texture.target != cacheLayouts[i][0] || texture.internalFormat != cacheLayouts[i][1] || texture.format != cacheLayouts[i][2])
+		{
+			return false;
+		}
+		std::uint32_t limit = (std::uint32_t)(texture.target == GL_TEXTURE_CUBE_MAP ? maxCubeSize : maxSize);
+		if (texture.size == 0 || texture.size > limit || texture.levelCount == 0 || texture.levelCount > 16)
+		{
+			return false;
+		}
+		if (texture.offset > file.size() || textureSize(texture) > file.size() - texture.offset)
+		{
+			return false;
+		}
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);	// small mips have rows of 6 bytes
+	maps.envCubemap = uploadTexture(textures[0], file.data());
+	maps.irradianceMap = uploadTexture(textures[1], file.data());
+	maps.prefilterMap = uploadTexture(textures[2], file.data());
+	maps.brdfLUT = uploadTexture(textures[3], file.data());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	return true;
+}
+
+bool saveIBLCache(const std::string& path, std::uint64_t hash, const IBLMaps& maps, const IBLSettings& settings)
+{
+	int environmentLevels = 1;
+	while ((settings.environmentSize >> environmentLevels) > 0)
+	{
+		++environmentLevels;
+	}
+
+	std::vector<unsigned char> data;
+	IBLCacheTexture textures[4];
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	const unsigned int sources[4] = { maps.envCubemap, maps.irradianceMap, maps.prefilterMap, maps.brdfLUT };
+	const int levelCounts[4] = { environmentLevels, 1, settings.prefilterMipCount, 1 };
+	for (int i = 0; i < 4; ++i)
+	{
+		textures[i] = readTexture(sources[i], cacheLayouts[i][0], cacheLayouts[i][1], cacheLayouts[i][2], levelCounts[i], data);
+	}
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+	// pixel data follows the header and texture table
+	for (int i = 0; i < 4; ++i)
+	{
+		textures[i].offset += sizeof(IBLCacheHeader) + sizeof(textures);
+	}
+
+	IBLCacheHeader header;
+	memcpy(header.magic, "IBLC", 4);
+	header.version = iblCacheVersion;
+	header.hash = hash;
+	header.textureCount = 4;
+	header.padding = 0;
+
+	std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+	file.write((const char*)&header, sizeof(header));
+	file.write((const char*)textures, sizeof(textures));
+	file.write((const char*)&data[0], data.size());
+	return file.good();
+}
@@ -0,0 +1,47 @@
+#ifndef IBLCACHE_H
+#define IBLCACHE_H
+
+#include "IBL.h"
+
+#include <cstdint>
+#include <string>
+
+
+// BAKED IBL CACHE
+//================
+// The baked maps are written next to the HDR as one binary file: a header, a table of textures,
+// then every mip of every face as half floats in upload order. Loading maps the file and
+// uploads straight from the mapping, so nothing is decoded or rendered.
+// The hash covers everything the bake depends on; a cache with any other hash is ignored.
+
+const std::uint32_t iblCacheVersion = 1;	// bump when the layout or the bake output changes
+
+struct IBLCacheHeader
+{
+	char magic[4];					// "IBLC"
+	std::uint32_t version;
+	std::uint64_t hash;
+	std::uint32_t textureCount;
+	std::uint32_t padding;
+};
+
+struct IBLCacheTexture
+{
+	std::uint32_t target;			// GL_TEXTURE_CUBE_MAP or GL_TEXTURE_2D
+	std::uint32_t internalFormat;	// GL_RGB16F or GL_RG16F
+	std::uint32_t format;			// GL_RGB or GL_RG, stored as GL_HALF_FLOAT
+	std::uint32_t size;				// width and height of mip 0
+	std::uint32_t levelCount;
+	std::uint32_t padding;
+	std::uint64_t offset;			// from the start of the file to mip 0, face 0
+};
+
+std::string iblCachePath(const char* hdrPath);
+
+// false if the file is missing, stale or malformed, maps is left untouched
+bool loadIBLCache(const std::string& path, std::uint64_t hash, IBLMaps& maps);
+
+// reads the maps back from the GPU, false if the file could not be written
+bool saveIBLCache(const std::string& path, std::uint64_t hash, const IBLMaps& maps, const IBLSettings& settings);
+
+#endif
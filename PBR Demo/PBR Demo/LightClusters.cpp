@@ -0,0 +1,313 @@
+#include "LightClusters.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+float pointLightRadius(const glm::vec3& colour, float cutoff)
+{
+	float intensity = std::max(colour.r, std::max(colour.g, colour.b));
+	return sqrtf(intensity / cutoff);
+}
+
+
+//CONSTRUCTOR
+//============
+LightClusters::LightClusters(const ClusterSettings& settings, unsigned int workerCount)
+	: settings(settings), boundsProjection(0.0f), viewportWidth(0), viewportHeight(0), lights(0), dropped(0),
+	generation(0), busyWorkers(0), stopping(false)
+{
+	clusterCount = settings.tilesX * settings.tilesY * settings.slices;
+	float logRange = logf(settings.farPlane / settings.nearPlane);
+	sliceScale = settings.slices / logRange;
+	sliceBias = settings.slices * logf(settings.nearPlane) / logRange;
+
+	clusterBounds.resize(clusterCount);
+	scratch.resize((size_t)clusterCount * settings.maxLightsPerCluster);
+	scratchCounts.resize(clusterCount);
+	clusterData.resize(clusterCount * 2);
+
+	glGenBuffers(3, buffers);
+	glGenTextures(3, textures);
+	const GLenum formats[3] = { GL_RGBA32F, GL_RG32UI, GL_R16UI };
+	for (int i = 0; i < 3; ++i)
+	{
+		glBindBuffer(GL_TEXTURE_BUFFER, buffers[i]);
+		glBufferData(GL_TEXTURE_BUFFER, 16, NULL, GL_STREAM_DRAW);
+		glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+		glTexBuffer(GL_TEXTURE_BUFFER, formats[i], buffers[i]);
+	}
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	// the calling thread takes a share too
+	if (workerCount == 0)
+	{
+		workerCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+	for (unsigned int i = 1; i < workerCount; ++i)
+	{
+		workers.push_back(std::thread(&LightClusters::workerLoop, this, (int)i));
+	}
+}
+
+LightClusters::~LightClusters()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	workAvailable.notify_all();
+	for (size_t i = 0; i < workers.size(); ++i)
+	{
+		workers[i].join();
+	}
+
+	glDeleteTextures(3, textures);
+	glDeleteBuffers(3, buffers);
+}
+
+
+
+// FUNCTIONS
+//==========
+void LightClusters::update(const std::vector<PointLight>& pointLights, const glm::mat4& view, const glm::mat4& projection)
+{
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	if (projection != boundsProjection || viewport[2] != viewportWidth || viewport[3] != viewportHeight)
+	{
+		viewportWidth = viewport[2];
+		viewportHeight = viewport[3];
+		buildBounds(projection);
+	}
+
+	// the range of clusters each light could touch, from its view space bounding box
+	lights = (int)pointLights.size();
+	ranges.resize(lights);
+	for (int i = 0; i < lights; ++i)
+	{
+		LightRange& range = ranges[i];
+		range.centre = glm::vec3(view * glm::vec4(pointLights[i].position, 1.0f));
+		range.radius = pointLights[i].radius;
+
+		float depth = -range.centre.z;
+		float nearDepth = depth - range.radius, farDepth = depth + range.radius;
+		if (farDepth < settings.nearPlane || nearDepth > settings.farPlane)
+		{
+			range.minSlice = 1;		// behind the camera or beyond the far plane
+			range.maxSlice = 0;
+			continue;
+		}
+		range.minSlice = sliceOf(std::max(nearDepth, settings.nearPlane));
+		range.maxSlice = sliceOf(std::min(farDepth, settings.farPlane));
+
+		range.minX = 0;
+		range.maxX = settings.tilesX - 1;
+		range.minY = 0;
+		range.maxY = settings.tilesY - 1;
+		if (nearDepth > settings.nearPlane)	// spheres crossing the near plane can cover the whole screen
+		{
+			// the projected box is bounded by its corners: ndc = P00 * x / depth - P20
+			glm::vec2 ndcMin(1e30f), ndcMax(-1e30f);
+			for (int corner = 0; corner < 8; ++corner)
+			{
+				float x = range.centre.x + ((corner & 1) ? range.radius : -range.radius);
+				float y = range.centre.y + ((corner & 2) ? range.radius : -range.radius);
+				float d = (corner & 4) ? farDepth : nearDepth;
+				glm::vec2 ndc(projection[0][0] * x / d - projection[2][0], projection[1][1] * y / d - projection[2][1]);
+				ndcMin = glm::min(ndcMin, ndc);
+				ndcMax = glm::max(ndcMax, ndc);
+			}
+			range.minX = std::max(0, (int)floorf((ndcMin.x * 0.5f + 0.5f) * settings.tilesX));
+			range.maxX = std::min(settings.tilesX - 1, (int)floorf((ndcMax.x * 0.5f + 0.5f) * settings.tilesX));
+			range.minY = std::max(0, (int)floorf((ndcMin.y * 0.5f + 0.5f) * settings.tilesY));
+			range.maxY = std::min(settings.tilesY - 1, (int)floorf((ndcMax.y * 0.5f + 0.5f) * settings.tilesY));
+		}
+	}
+
+	// sphere against cluster box tests, sliced up between the workers and this thread
+	std::fill(scratchCounts.begin(), scratchCounts.end(), 0u);
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		++generation;
+		busyWorkers = (int)workers.size();
+	}
+	workAvailable.notify_all();
+
+	int shares = (int)workers.size() + 1;
+	assignSlices(0, settings.slices / shares);
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		workDone.wait(lock, [this]() { return busyWorkers == 0; });
+	}
+
+	// pack the lists back to back
+	indices.clear();
+	dropped = 0;
+	for (int cluster = 0; cluster < clusterCount; ++cluster)
+	{
+		unsigned int count = scratchCounts[cluster];
+		if (count > (unsigned int)settings.maxLightsPerCluster)
+		{
+			dropped += count - settings.maxLightsPerCluster;
+			count = settings.maxLightsPerCluster;
+		}
+		clusterData[cluster * 2] = (unsigned int)indices.size();
+		clusterData[cluster * 2 + 1] = count;
+
+		const unsigned short* list = &scratch[(size_t)cluster * settings.maxLightsPerCluster];
+		indices.insert(indices.end(), list, list + count);
+	}
+
+	lightData.resize(std::max(1, lights * 2));
+	for (int i = 0; i < lights; ++i)
+	{
+		lightData[i * 2] = glm::vec4(pointLights[i].position, pointLights[i].radius);
+		lightData[i * 2 + 1] = glm::vec4(pointLights[i].colour, 0.0f);
+	}
+	if (indices.empty())
+	{
+		indices.push_back(0);	// buffer textures can't be empty
+	}
+
+	// orphan and refill, last frame's draws may still be reading the old storage
+	glBindBuffer(GL_TEXTURE_BUFFER, buffers[0]);
+	glBufferData(GL_TEXTURE_BUFFER, lightData.size() * sizeof(glm::vec4), &lightData[0], GL_STREAM_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, buffers[1]);
+	glBufferData(GL_TEXTURE_BUFFER, clusterData.size() * sizeof(unsigned int), &clusterData[0], GL_STREAM_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, buffers[2]);
+	glBufferData(GL_TEXTURE_BUFFER, indices.size() * sizeof(unsigned short), &indices[0], GL_STREAM_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void LightClusters::writeUniforms(FrameUniforms& uniforms) const
+{
+	uniforms.clusterGrid = glm::uvec4(settings.tilesX, settings.tilesY, settings.slices, lights);
+	uniforms.clusterScale = glm::vec4((float)settings.tilesX / std::max(1, viewportWidth), (float)settings.tilesY / std::max(1, viewportHeight), sliceScale, sliceBias);
+}
+
+void LightClusters::bind(unsigned int firstUnit) const
+{
+	for (int i = 0; i < 3; ++i)
+	{
+		glActiveTexture(GL_TEXTURE0 + firstUnit + i);
+		glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+	}
+}
+
+int LightClusters::lightCount() const
+{
+	return lights;
+}
+
+int LightClusters::assignedLightCount() const
+{
+	return (int)indices.size();
+}
+
+int LightClusters::droppedLightCount() const
+{
+	return dropped;
+}
+
+// view space box of every cluster: the tile's corners at the slice's near and far depth
+void LightClusters::buildBounds(const glm::mat4& projection)
+{
+	boundsProjection = projection;
+	for (int slice = 0; slice < settings.slices; ++slice)
+	{
+		float nearDepth = settings.nearPlane * powf(settings.farPlane / settings.nearPlane, (float)slice / settings.slices);
+		float farDepth = settings.nearPlane * powf(settings.farPlane / settings.nearPlane, (float)(slice + 1) / settings.slices);
+		for (int y = 0; y < settings.tilesY; ++y)
+		{
+			for (int x = 0; x < settings.tilesX; ++x)
+			{
+				// x = depth * (ndc + P20) / P00
+				glm::vec2 ndcMin(-1.0f + 2.0f * x / settings.tilesX, -1.0f + 2.0f * y / settings.tilesY);
+				glm::vec2 ndcMax(-1.0f + 2.0f * (x + 1) / settings.tilesX, -1.0f + 2.0f * (y + 1) / settings.tilesY);
+				glm::vec2 scale(1.0f / projection[0][0], 1.0f / projection[1][1]);
+				glm::vec2 offset(projection[2][0], projection[2][1]);
+
+				glm::vec2 nearMin = nearDepth * (ndcMin + offset) * scale, nearMax = nearDepth * (ndcMax + offset) * scale;
+				glm::vec2 farMin = farDepth * (ndcMin + offset) * scale, farMax = farDepth * (ndcMax + offset) * scale;
+
+				Bounds& bounds = clusterBounds[(slice * settings.tilesY + y) * settings.tilesX + x];
+				bounds.min = glm::vec3(glm::min(nearMin, farMin), -farDepth);
+				bounds.max = glm::vec3(glm::max(nearMax, farMax), -nearDepth);
+			}
+		}
+	}
+}
+
+void LightClusters::assignSlices(int firstSlice, int lastSlice)
+{
+	for (int slice = firstSlice; slice < lastSlice; ++slice)
+	{
+		for (int light = 0; light < lights; ++light)
+		{
+			const LightRange& range = ranges[light];
+			if (slice < range.minSlice || slice > range.maxSlice)
+			{
+				continue;
+			}
+
+			float radiusSquared = range.radius * range.radius;
+			for (int y = range.minY; y <= range.maxY; ++y)
+			{
+				for (int x = range.minX; x <= range.maxX; ++x)
+				{
+					int cluster = (slice * settings.tilesY + y) * settings.tilesX + x;
+					const Bounds& bounds = clusterBounds[cluster];
+					glm::vec3 closest = glm::clamp(range.centre, bounds.min, bounds.max);
+					glm::vec3 offset = closest - range.centre;
+					if (glm::dot(offset, offset) > radiusSquared)
+					{
+						continue;
+					}
+
+					unsigned int count = scratchCounts[cluster]++;	// counts past the cap so the overflow can be reported
+					if (count < (unsigned int)settings.maxLightsPerCluster)
+					{
+						scratch[(size_t)cluster * settings.maxLightsPerCluster + count] = (unsigned short)light;
+					}
+				}
+			}
+		}
+	}
+}
+
+int LightClusters::sliceOf(float depth) const
+{
+	int slice = (int)floorf(logf(depth) * sliceScale - sliceBias);
+	return std::min(std::max(slice, 0), settings.slices - 1);
+}
+
+void LightClusters::workerLoop(int worker)
+{
+	unsigned int seen = 0;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			workAvailable.wait(lock, [this, seen]() { return stopping || generation != seen; });
+			if (stopping)
+			{
+				return;
+			}
+			seen = generation;
+		}
+
+		int shares = (int)workers.size() + 1;
+		assignSlices(settings.slices * worker / shares, settings.slices * (worker + 1) / shares);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (--busyWorkers == 0)
+			{
+				workDone.notify_one();
+			}
+		}
+	}
+}
@@ -0,0 +1,104 @@
+#ifndef LIGHTCLUSTERS_H
+#define LIGHTCLUSTERS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <FrameUniforms.h>
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+
+struct PointLight
+{
+	glm::vec3 position;
+	float radius;			// light is faded to nothing here, lights only reach the clusters this sphere touches
+	glm::vec3 colour;		// radiant intensity, falls off with distance squared inside the radius
+};
+
+// radius at which an inverse square light of this colour drops below cutoff
+float pointLightRadius(const glm::vec3& colour, float cutoff = 0.05f);
+
+// froxel grid: screen tiles by depth slices, the slices spaced exponentially between near and far
+struct ClusterSettings
+{
+	int tilesX = 16;
+	int tilesY = 9;
+	int slices = 24;
+	float nearPlane = 0.1f;				// must match the projection
+	float farPlane = 100.0f;
+	int maxLightsPerCluster = 256;		// any more reaching one cluster are dropped
+};
+
+// Clustered forward shading. Every frame update() assigns each light to the clusters its sphere
+// overlaps and uploads three texture buffers fs_PBR walks per fragment:
+//	lightData		RGBA32F, two texels per light: position + radius, colour
+//	clusterLights	RG32UI, per cluster: first index, count
+//	lightIndices	R16UI, the clusters' light lists back to back
+// The assignment is split by depth slice over worker threads; each slice's clusters are only ever
+// written by one thread. A compute pass would need GL 4.3, the demo runs on a 4.0 context.
+class LightClusters
+{
+public:
+	LightClusters(const ClusterSettings& settings = ClusterSettings(), unsigned int workerCount = 0);	// 0 workers = one per core
+	~LightClusters();
+
+	// cluster bounds follow the projection and the current viewport
+	void update(const std::vector<PointLight>& lights, const glm::mat4& view, const glm::mat4& projection);
+	void writeUniforms(FrameUniforms& uniforms) const;		// grid size and the depth slice mapping
+	void bind(unsigned int firstUnit) const;				// lightData, clusterLights, lightIndices on three units
+
+	int lightCount() const;
+	int assignedLightCount() const;	// light/cluster pairs in the last update
+	int droppedLightCount() const;	// pairs that didn't fit in maxLightsPerCluster
+
+private:
+	struct Bounds
+	{
+		glm::vec3 min, max;
+	};
+	struct LightRange				// view space light and the clusters it can reach
+	{
+		glm::vec3 centre;
+		float radius;
+		int minX, maxX, minY, maxY, minSlice, maxSlice;
+	};
+
+	ClusterSettings settings;
+	int clusterCount;
+	float sliceScale, sliceBias;	// slice = log(depth) * sliceScale - sliceBias
+
+	std::vector<Bounds> clusterBounds;	// view space, rebuilt when the projection or viewport changes
+	glm::mat4 boundsProjection;
+	int viewportWidth, viewportHeight;
+
+	std::vector<LightRange> ranges;
+	std::vector<unsigned short> scratch;		// maxLightsPerCluster per cluster
+	std::vector<unsigned int> scratchCounts;
+	std::vector<unsigned int> clusterData;		// offset, count
+	std::vector<unsigned short> indices;
+	std::vector<glm::vec4> lightData;
+	int lights, dropped;
+
+	// GL objects: one buffer and one buffer texture per list
+	unsigned int buffers[3];
+	unsigned int textures[3];
+
+	void buildBounds(const glm::mat4& projection);
+	void assignSlices(int firstSlice, int lastSlice);	// [firstSlice, lastSlice)
+	int sliceOf(float depth) const;
+
+	// workers, each one takes a share of the slices every update
+	void workerLoop(int worker);
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable workAvailable;
+	std::condition_variable workDone;
+	unsigned int generation;	// bumped once per update to release the workers
+	int busyWorkers;
+	bool stopping;
+};
+#endif
@@ -0,0 +1,115 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+//CONSTRUCTOR
+//============
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string& path)
+	: mapped(NULL), mappedSize(0), file(INVALID_HANDLE_VALUE), mapping(NULL)
+{
+	file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		return;	// empty files can't be mapped
+	}
+
+	mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL)
+	{
+		return;
+	}
+
+	mapped = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (mapped)
+	{
+		mappedSize = (std::size_t)fileSize.QuadPart;
+	}
+}
+
+MappedFile::~MappedFile()
+{
+	if (mapped)
+	{
+		UnmapViewOfFile(mapped);
+	}
+	if (mapping)
+	{
+		CloseHandle(mapping);
+	}
+	if (file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(file);
+	}
+}
+#else
+MappedFile::MappedFile(const std::string& path)
+	: mapped(NULL), mappedSize(0), file(-1)
+{
+	file = open(path.c_str(), O_RDONLY);
+	if (file < 0)
+	{
+		return;
+	}
+
+	struct stat info;
+	if (fstat(file, &info) != 0 || info.st_size == 0)
+	{
+		return;	// empty files can't be mapped
+	}
+
+	void* view = mmap(NULL, (std::size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	if (view != MAP_FAILED)
+	{
+		mapped = (const unsigned char*)view;
+		mappedSize = (std::size_t)info.st_size;
+	}
+}
+
+MappedFile::~MappedFile()
+{
+	if (mapped)
+	{
+		munmap((void*)mapped, mappedSize);
+	}
+	if (file >= 0)
+	{
+		close(file);
+	}
+}
+#endif
+
+
+
+// FUNCTIONS
+//==========
+bool MappedFile::isOpen() const
+{
+	return mapped != NULL;
+}
+
+const unsigned char* MappedFile::data() const
+{
+	return mapped;
+}
+
+std::size_t MappedFile::size() const
+{
+	return mappedSize;
+}
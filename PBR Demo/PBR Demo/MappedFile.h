@@ -0,0 +1,34 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+
+// Read-only memory mapping of a whole file. The OS pages it in on demand, so handing data()
+// straight to glTexImage2D avoids copying the file into a buffer of our own first.
+class MappedFile
+{
+public:
+	MappedFile(const std::string& path);
+	~MappedFile();
+
+	bool isOpen() const;					// false if the file is missing, empty or could not be mapped
+	const unsigned char* data() const;
+	std::size_t size() const;
+
+private:
+	MappedFile(const MappedFile&);			// not copyable, the destructor unmaps
+	MappedFile& operator=(const MappedFile&);
+
+	const unsigned char* mapped;
+	std::size_t mappedSize;
+
+#ifdef _WIN32
+	void* file;			// HANDLEs
+	void* mapping;
+#else
+	int file;
+#endif
+};
+#endif
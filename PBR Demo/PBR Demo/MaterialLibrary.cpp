@@ -0,0 +1,266 @@
+#include "MaterialLibrary.h"
+#include "Primitives.h"
+
+#include "GLCaps.h"
+
+
+static const char* const packChannelShaderPaths[2] = { "PBR Project/PBR Demo/Shaders/vs_PBR-BRDF.glsl", "PBR Project/PBR Demo/Shaders/fs_PBR-PackChannel.glsl" };
+
+
+//CONSTRUCTOR
+//============
+MaterialLibrary::MaterialLibrary(int materialCount, int layerSize, bool compressed)
+	: materialCount(materialCount), layerSize(layerSize), mipCount(1), sources(MATERIAL_MAP_COUNT * materialCount, 0),
+	channelSources(MATERIAL_MAP_COUNT * materialCount * 4, 0), dirtyLayers(MATERIAL_MAP_COUNT * materialCount, false), handleBuffer(0),
+	shader_packChannel(packChannelShaderPaths[0], packChannelShaderPaths[1])
+{
+	while ((layerSize >> mipCount) > 0)
+	{
+		++mipCount;
+	}
+
+	formats[ALBEDO_MAP] = compressed ? GL_COMPRESSED_RGBA_BPTC_UNORM : GL_RGBA8;
+	formats[NORMAL_MAP] = compressed ? GL_COMPRESSED_RG_RGTC2 : GL_RGBA8;
+	formats[ORM_MAP] = compressed ? GL_COMPRESSED_RGBA_BPTC_UNORM : GL_RGBA8;
+
+	glGenTextures(MATERIAL_MAP_COUNT, arrays);
+	for (int map = 0; map < MATERIAL_MAP_COUNT; ++map)
+	{
+		bool blockCompressed = formats[map] != GL_RGBA8;
+
+		glBindTexture(GL_TEXTURE_2D_ARRAY, arrays[map]);
+		for (int level = 0; level < mipCount; ++level)
+		{
+			int size = layerSize >> level;
+			if (blockCompressed)
+			{
+				glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, formats[map], size, size, materialCount, 0, (GLsizei)(compressedSize(size, size) * materialCount), NULL);
+			}
+			else
+			{
+				glTexImage3D(GL_TEXTURE_2D_ARRAY, level, formats[map], size, size, materialCount, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+			}
+		}
+
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	}
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	glGenFramebuffers(1, &readFBO);
+	glGenFramebuffers(1, &drawFBO);
+
+	shader_packChannel.use();
+	shader_packChannel.setInt("source", 0);
+}
+
+
+
+// FUNCTIONS
+//==========
+void MaterialLibrary::setMap(int material, MaterialMap map, unsigned int texture)
+{
+	sources[map * materialCount + material] = texture;
+	dirtyLayers[map * materialCount + material] = true;
+}
+
+void MaterialLibrary::setChannelMap(int material, MaterialMap map, int channel, unsigned int texture)
+{
+	channelSources[(map * materialCount + material) * 4 + channel] = texture;
+	dirtyLayers[map * materialCount + material] = true;
+}
+
+void MaterialLibrary::sourcesChanged(const std::vector<unsigned int>& textures)
+{
+	for (std::size_t i = 0; i < textures.size(); ++i)
+	{
+		for (int layer = 0; layer < MATERIAL_MAP_COUNT * materialCount; ++layer)
+		{
+			bool used = sources[layer] == textures[i];
+			for (int channel = 0; channel < 4; ++channel)
+			{
+				used = used || channelSources[layer * 4 + channel] == textures[i];
+			}
+			if (used && textures[i] != 0)
+			{
+				dirtyLayers[layer] = true;
+			}
+		}
+	}
+}
+
+bool MaterialLibrary::setCompressedMap(int material, MaterialMap map, const CompressedImageView& image)
+{
+	int first = 0;
+	while (first < image.levelCount && (image.width >> first) > layerSize)
+	{
+		++first;
+	}
+	if (first == image.levelCount || (image.width >> first) != layerSize || (image.height >> first) != layerSize)
+	{
+		return false;
+	}
+
+	GLenum imageFormat = image.format == BLOCK_FORMAT_BC7 ? GL_COMPRESSED_RGBA_BPTC_UNORM : GL_COMPRESSED_RG_RGTC2;
+	bool direct = imageFormat == formats[map];
+
+	std::vector<unsigned char> decoded;
+	glBindTexture(GL_TEXTURE_2D_ARRAY, arrays[map]);
+	for (int level = 0; level < mipCount && first + level < image.levelCount; ++level)
+	{
+		int size = layerSize >> level;
+		if (direct)
+		{
+			glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, material, size, size, 1, imageFormat, (GLsizei)image.levelSizes[first + level], image.levels[first + level]);
+			continue;
+		}
+
+		// CPU fallback when the driver can't sample this format
+		decoded.resize((std::size_t)size * size * 4);
+		decompressImage(image.format, image.levels[first + level], size, size, &decoded[0]);
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, material, size, size, 1, GL_RGBA, GL_UNSIGNED_BYTE, &decoded[0]);
+	}
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	// the layer holds the DDS now, refresh() leaves it alone
+	sources[map * materialCount + material] = 0;
+	dirtyLayers[map * materialCount + material] = false;
+	for (int channel = 0; channel < 4; ++channel)
+	{
+		channelSources[(map * materialCount + material) * 4 + channel] = 0;
+	}
+	return true;
+}
+
+unsigned int MaterialLibrary::getMap(int material, MaterialMap map) const
+{
+	return sources[map * materialCount + material];
+}
+
+int MaterialLibrary::count() const
+{
+	return materialCount;
+}
+
+// a filtered blit per layer does the resampling on the GPU, whatever size and channel count the source has.
+// channel sources are drawn over it with a fullscreen quad each, the colour mask keeping the other channels.
+// only arrays that had something copied in get their mips rebuilt, layers from setCompressedMap() bring their own.
+// glGenerateMipmap has no per layer form, so one changed layer still rebuilds its whole array's mips
+void MaterialLibrary::refresh()
+{
+	GLint previousFramebuffer, previousViewport[4];
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+	glGetIntegerv(GL_VIEWPORT, previousViewport);
+	GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, readFBO);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, drawFBO);
+	glViewport(0, 0, layerSize, layerSize);
+	glDisable(GL_DEPTH_TEST);
+	for (int map = 0; map < MATERIAL_MAP_COUNT; ++map)
+	{
+		if (formats[map] != GL_RGBA8)
+		{
+			continue;	// block compressed, not renderable
+		}
+
+		bool copied = false;
+		for (int material = 0; material < materialCount; ++material)
+		{
+			if (!dirtyLayers[map * materialCount + material])
+			{
+				continue;
+			}
+			dirtyLayers[map * materialCount + material] = false;
+
+			glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, arrays[map], 0, material);
+
+			unsigned int source = sources[map * materialCount + material];
+			if (source != 0)
+			{
+				int width, height;
+				glBindTexture(GL_TEXTURE_2D, source);
+				glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+				glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+
+				glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, source, 0);
+				glBlitFramebuffer(0, 0, width, height, 0, 0, layerSize, layerSize, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+				copied = true;
+			}
+
+			for (int channel = 0; channel < 4; ++channel)
+			{
+				unsigned int channelSource = channelSources[(map * materialCount + material) * 4 + channel];
+				if (channelSource == 0)
+				{
+					continue;
+				}
+
+				shader_packChannel.use();
+				glActiveTexture(GL_TEXTURE0);
+				glBindTexture(GL_TEXTURE_2D, channelSource);
+				glColorMask(channel == 0, channel == 1, channel == 2, channel == 3);
+				renderQuad();
+				copied = true;
+			}
+		}
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+		if (copied)
+		{
+			glBindTexture(GL_TEXTURE_2D_ARRAY, arrays[map]);
+			glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+		}
+	}
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	if (depthTest)
+	{
+		glEnable(GL_DEPTH_TEST);
+	}
+	glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+	glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+}
+
+void MaterialLibrary::bind(unsigned int firstUnit) const
+{
+	for (int map = 0; map < MATERIAL_MAP_COUNT; ++map)
+	{
+		glActiveTexture(GL_TEXTURE0 + firstUnit + map);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, arrays[map]);
+	}
+}
+
+// std140 packs the block's three samplers as 64 bit handles back to back, the same as this array
+bool MaterialLibrary::makeResident()
+{
+	if (!glCaps.bindlessTexture)
+	{
+		return false;
+	}
+	if (handleBuffer != 0)
+	{
+		return true;
+	}
+
+	GLuint64 handles[MATERIAL_MAP_COUNT];
+	for (int map = 0; map < MATERIAL_MAP_COUNT; ++map)
+	{
+		handles[map] = glGetTextureHandleARB(arrays[map]);
+		glMakeTextureHandleResidentARB(handles[map]);
+	}
+
+	glGenBuffers(1, &handleBuffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, handleBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(handles), handles, GL_STATIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	glBindBufferBase(GL_UNIFORM_BUFFER, materialTextureBinding, handleBuffer);
+	return true;
+}
+
+bool MaterialLibrary::isResident() const
+{
+	return handleBuffer != 0;
+}
@@ -0,0 +1,77 @@
+#ifndef MATERIALLIBRARY_H
+#define MATERIALLIBRARY_H
+
+#include <glad/glad.h>
+
+#include <Shader.h>
+#include <TextureCompression.h>
+
+#include <cstddef>
+#include <vector>
+
+
+enum MaterialMap
+{
+	ALBEDO_MAP,
+	NORMAL_MAP,
+	ORM_MAP,			// occlusion, roughness and metallic packed into r, g and b
+	MATERIAL_MAP_COUNT
+};
+
+// uniform block binding of the MaterialTextures block bindless shaders read the array handles from
+const unsigned int materialTextureBinding = 1;
+
+// channels of ORM_MAP, the same order glTF uses
+enum ORMChannel
+{
+	ORM_OCCLUSION,
+	ORM_ROUGHNESS,
+	ORM_METALLIC
+};
+
+// Keeps the source texture of every map of every material and mirrors them into one texture array per
+// map type, layer = material index. Shaders pick the layer per instance, so a whole grid of spheres with
+// different materials is drawn without touching texture bindings. Layers are resampled to one size
+// because every layer of an array has to match.
+// Packed maps take a separate single channel source per channel, drawn into their layer by refresh().
+// refresh() only redraws layers whose sources were set or reported changed since it last ran.
+// With compressed set the albedo and ORM arrays are BC7 and the normal array BC5, filled only through
+// setCompressedMap(); they can't be drawn into so any source textures set for them are ignored.
+// With ARB_bindless_texture the arrays can be made resident once instead of bound: their handles go in a
+// uniform buffer on materialTextureBinding and shaders built with BINDLESS_TEXTURES sample through them.
+// Layers can still be refreshed afterwards, only the arrays' storage and parameters are fixed from then on.
+class MaterialLibrary
+{
+public:
+	MaterialLibrary(int materialCount, int layerSize = 1024, bool compressed = false);
+
+	void setMap(int material, MaterialMap map, unsigned int texture);	// source 2D texture, copied in by refresh()
+	void setChannelMap(int material, MaterialMap map, int channel, unsigned int texture);	// source's .r into one channel of the layer
+	void sourcesChanged(const std::vector<unsigned int>& textures);	// e.g. just uploaded, their layers are redrawn by the next refresh()
+
+	// upload a DDS straight into a layer, mips included, starting at its level that is layerSize wide.
+	// blocks go in as they are when the array has the same format, otherwise they are decoded on the CPU.
+	// false if no level fits
+	bool setCompressedMap(int material, MaterialMap map, const CompressedImageView& image);
+	unsigned int getMap(int material, MaterialMap map) const;
+	int count() const;
+
+	void refresh();								// recopy the changed layers' sources and rebuild those arrays' mips
+	void bind(unsigned int firstUnit) const;	// arrays on units firstUnit .. firstUnit + MATERIAL_MAP_COUNT - 1
+	bool makeResident();						// needs glCaps.bindlessTexture, bind() isn't needed after it
+	bool isResident() const;
+
+private:
+	int materialCount;
+	int layerSize;
+	int mipCount;
+	GLenum formats[MATERIAL_MAP_COUNT];
+	std::vector<unsigned int> sources;			// [map * materialCount + material]
+	std::vector<unsigned int> channelSources;	// [(map * materialCount + material) * 4 + channel]
+	std::vector<bool> dirtyLayers;				// [map * materialCount + material]
+	unsigned int arrays[MATERIAL_MAP_COUNT];
+	unsigned int readFBO, drawFBO;
+	unsigned int handleBuffer;					// 0 until makeResident()
+	Shader shader_packChannel;
+};
+#endif
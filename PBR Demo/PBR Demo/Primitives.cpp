@@ -0,0 +1,493 @@
+#include "Primitives.h"
+#include "GLCaps.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+
+// VERTEX FORMAT
+//==============
+// the sphere and the cube share one 20 byte vertex instead of 12 floats. Both fit in [-1, 1], so
+// positions are normalised shorts
+struct PackedVertex
+{
+	short position[4];				// SNORM16, w is the tangent's handedness
+	unsigned short texCoords[2];	// UNORM16
+	short normal[2];				// SNORM16, octahedral
+	short tangent[2];				// SNORM16, octahedral
+};
+
+static short toSnorm16(float value)
+{
+	return (short)std::lround(glm::clamp(value, -1.0f, 1.0f) * 32767.0f);
+}
+
+static unsigned short toUnorm16(float value)
+{
+	return (unsigned short)std::lround(glm::clamp(value, 0.0f, 1.0f) * 65535.0f);
+}
+
+// unit vector folded onto the octahedron then flattened to [-1, 1]^2, as fs_PBR's OctahedralEncode
+static glm::vec2 octahedralEncode(glm::vec3 n)
+{
+	n /= std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+	glm::vec2 signs(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+	return n.z >= 0.0f ? glm::vec2(n.x, n.y) : (1.0f - glm::abs(glm::vec2(n.y, n.x))) * signs;
+}
+
+// tangent.xyz points along increasing u, tangent.w is +1 or -1: the bitangent is w * cross(normal, tangent)
+// and points up the image, towards decreasing v, as the maps are loaded top row first
+static PackedVertex packVertex(const glm::vec3& position, const glm::vec2& texCoords, const glm::vec3& normal, const glm::vec4& tangent)
+{
+	glm::vec2 octahedral = octahedralEncode(normal);
+	glm::vec2 octahedralTangent = octahedralEncode(glm::vec3(tangent));
+	PackedVertex vertex;
+	vertex.position[0] = toSnorm16(position.x);
+	vertex.position[1] = toSnorm16(position.y);
+	vertex.position[2] = toSnorm16(position.z);
+	vertex.position[3] = toSnorm16(tangent.w);
+	vertex.texCoords[0] = toUnorm16(texCoords.x);
+	vertex.texCoords[1] = toUnorm16(texCoords.y);
+	vertex.normal[0] = toSnorm16(octahedral.x);
+	vertex.normal[1] = toSnorm16(octahedral.y);
+	vertex.tangent[0] = toSnorm16(octahedralTangent.x);
+	vertex.tangent[1] = toSnorm16(octahedralTangent.y);
+	return vertex;
+}
+
+// per vertex tangents for an indexed triangle list, so normal maps need no per fragment tangent frame.
+// every triangle's direction of increasing u is summed onto its corners, then each sum is made
+// orthogonal to the vertex normal. the handedness comes from which side of it increasing v lies on
+static void computeTangents(const glm::vec3* positions, const glm::vec2* texCoords, const glm::vec3* normals, int vertexCount,
+	const unsigned short* indices, int indexCount, glm::vec4* tangents)
+{
+	std::vector<glm::vec3> uDirections(vertexCount, glm::vec3(0.0f)), vDirections(vertexCount, glm::vec3(0.0f));
+	for (int i = 0; i + 2 < indexCount; i += 3)
+	{
+		int a = indices[i], b = indices[i + 1], c = indices[i + 2];
+		glm::vec3 edge1 = positions[b] - positions[a], edge2 = positions[c] - positions[a];
+		glm::vec2 st1 = texCoords[b] - texCoords[a], st2 = texCoords[c] - texCoords[a];
+		float determinant = st1.x * st2.y - st2.x * st1.y;
+		if (std::fabs(determinant) < 1e-12f)
+		{
+			continue;	// no texture space area, nothing to orient by
+		}
+
+		glm::vec3 dPdu = (edge1 * st2.y - edge2 * st1.y) / determinant;
+		glm::vec3 dPdv = (edge2 * st1.x - edge1 * st2.x) / determinant;
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			uDirections[indices[i + corner]] += dPdu;
+			vDirections[indices[i + corner]] += dPdv;
+		}
+	}
+
+	for (int i = 0; i < vertexCount; ++i)
+	{
+		const glm::vec3& n = normals[i];
+		glm::vec3 t = uDirections[i] - n * glm::dot(n, uDirections[i]);
+		if (glm::dot(t, t) < 1e-12f)
+		{
+			t = std::fabs(n.x) < 0.9f ? glm::cross(n, glm::vec3(1.0f, 0.0f, 0.0f)) : glm::cross(n, glm::vec3(0.0f, 1.0f, 0.0f));	// any tangent will do
+		}
+		t = glm::normalize(t);
+		tangents[i] = glm::vec4(t, glm::dot(glm::cross(n, t), vDirections[i]) > 0.0f ? -1.0f : 1.0f);
+	}
+}
+
+// attributes 0 position (w tangent handedness), 1 texture coordinates, 2 normal and 8 tangent from the bound GL_ARRAY_BUFFER
+static void setPackedVertexFormat()
+{
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 4, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, position));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, texCoords));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, normal));
+	glEnableVertexAttribArray(8);
+	glVertexAttribPointer(8, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, tangent));
+}
+
+
+
+// SPHERE
+//=======
+unsigned int sphereVAO = 0;
+static GLenum sphereIndexType;		// 16 bit unless a level has more vertices than that can index
+
+// LOD 0 is the original LearnOpenGL sphere, each level after it has half the segments
+static const unsigned int sphereLodSegments[sphereLodCount] = { 64, 32, 16, 8 };
+// screen radius in pixels below which a sphere drops to the next level
+static const float sphereLodRadii[sphereLodCount - 1] = { 160.0f, 64.0f, 24.0f };
+static const float sphereLodHysteresis = 0.15f;		// how far past a switching radius a sphere has to be before it changes
+
+struct SphereLod
+{
+	int baseVertex;
+	size_t firstIndex;		// byte offset into the index buffer
+	int indexCount;
+};
+static SphereLod sphereLods[sphereLodCount];
+
+// builds every LOD of the sphere mesh into one vertex and one index buffer, attributes 0-2 and 8 are
+// per vertex, 3-7 per instance (see SphereInstance). Each level's indices start from its own first
+// vertex and are drawn with a base vertex. The buffers are sized up front and written mapped
+static void createSphere()
+{
+	unsigned int vertexCount = 0, indexCount = 0, largestLevel = 0;
+	for (int lod = 0; lod < sphereLodCount; ++lod)
+	{
+		unsigned int segments = sphereLodSegments[lod];
+		unsigned int levelVertices = (segments + 1) * (segments + 1);
+		vertexCount += levelVertices;
+		indexCount += segments * (segments + 1) * 2;
+		largestLevel = std::max(largestLevel, levelVertices);
+	}
+	sphereIndexType = largestLevel <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	size_t indexSize = sphereIndexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+
+	unsigned int vbo, ebo;
+	glGenVertexArrays(1, &sphereVAO);
+	glGenBuffers(1, &vbo);
+	glGenBuffers(1, &ebo);
+	glBindVertexArray(sphereVAO);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(PackedVertex), NULL, GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * indexSize, NULL, GL_STATIC_DRAW);
+
+	PackedVertex* vertices = (PackedVertex*)glMapBufferRange(GL_ARRAY_BUFFER, 0, vertexCount * sizeof(PackedVertex), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	unsigned char* indices = (unsigned char*)glMapBufferRange(GL_ELEMENT_ARRAY_BUFFER, 0, indexCount * indexSize, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	unsigned int vertex = 0, index = 0;
+	const float PI = 3.14159265359f;
+	for (int lod = 0; lod < sphereLodCount; ++lod)
+	{
+		const unsigned int X_SEGMENTS = sphereLodSegments[lod];
+		const unsigned int Y_SEGMENTS = sphereLodSegments[lod];
+		sphereLods[lod].baseVertex = (int)vertex;
+		sphereLods[lod].firstIndex = index * indexSize;
+
+		for (unsigned int y = 0; y <= Y_SEGMENTS; ++y)
+		{
+			for (unsigned int x = 0; x <= X_SEGMENTS; ++x)
+			{
+				float xSegment = (float)x / (float)X_SEGMENTS;
+				float ySegment = (float)y / (float)Y_SEGMENTS;
+
+				float xPos = std::cos(xSegment * 2.0f * PI) * std::sin(ySegment * PI);
+				float yPos = std::cos(ySegment * PI);
+				float zPos = std::sin(xSegment * 2.0f * PI) * std::sin(ySegment * PI);
+
+				// the tangent follows u around the equator. v runs from the top pole down, the same way as
+				// cross(normal, tangent), so the bitangent up the image is its negative
+				glm::vec3 position(xPos, yPos, zPos);
+				glm::vec4 tangent(-std::sin(xSegment * 2.0f * PI), 0.0f, std::cos(xSegment * 2.0f * PI), -1.0f);
+				vertices[vertex++] = packVertex(position, glm::vec2(xSegment, ySegment), position, tangent);
+			}
+		}
+
+		unsigned int firstIndex = index;
+		bool oddRow = false;
+		for (unsigned int y = 0; y < Y_SEGMENTS; ++y)
+		{
+			for (unsigned int i = 0; i <= X_SEGMENTS; ++i)
+			{
+				unsigned int x = oddRow ? X_SEGMENTS - i : i;	// odd rows run back the other way
+				unsigned int upper = y * (X_SEGMENTS + 1) + x;
+				unsigned int lower = (y + 1) * (X_SEGMENTS + 1) + x;
+				unsigned int pair[2] = { oddRow ? lower : upper, oddRow ? upper : lower };
+				for (int j = 0; j < 2; ++j, ++index)
+				{
+					if (sphereIndexType == GL_UNSIGNED_SHORT)
+					{
+						((unsigned short*)indices)[index] = (unsigned short)pair[j];
+					}
+					else
+					{
+						((unsigned int*)indices)[index] = pair[j];
+					}
+				}
+			}
+			oddRow = !oddRow;
+		}
+		sphereLods[lod].indexCount = (int)(index - firstIndex);
+	}
+	glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER);
+	glUnmapBuffer(GL_ARRAY_BUFFER);
+
+	setPackedVertexFormat();
+}
+
+// one sphere, its model matrix and material come from setSphereInstance()
+void renderSphere(int lod)
+{
+	if (sphereVAO == 0)
+	{
+		createSphere();
+	}
+
+	glBindVertexArray(sphereVAO);
+	for (unsigned int i = 0; i < 5; ++i)
+	{
+		glDisableVertexAttribArray(3 + i);	// use the values from setSphereInstance rather than the instance buffer
+	}
+	const SphereLod& mesh = sphereLods[lod];
+	glDrawElementsBaseVertex(GL_TRIANGLE_STRIP, mesh.indexCount, sphereIndexType, (void*)mesh.firstIndex, mesh.baseVertex);
+}
+
+// per-draw path: the instance attributes are left disabled and set as constant vertex attributes
+void setSphereInstance(const SphereInstance& instance)
+{
+	for (unsigned int column = 0; column < 4; ++column)
+	{
+		glVertexAttrib4fv(3 + column, &instance.model[column][0]);
+	}
+	glVertexAttribI1ui(7, instance.material);
+}
+
+// instance attributes read SphereInstances from instanceBuffer starting at offset, leaves the sphere VAO bound
+static void bindSphereInstances(unsigned int instanceBuffer, size_t offset)
+{
+	if (sphereVAO == 0)
+	{
+		createSphere();
+	}
+
+	glBindVertexArray(sphereVAO);
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	for (unsigned int column = 0; column < 4; ++column)
+	{
+		glEnableVertexAttribArray(3 + column);
+		glVertexAttribPointer(3 + column, 4, GL_FLOAT, GL_FALSE, sizeof(SphereInstance), (void*)(offset + column * sizeof(glm::vec4)));
+		glVertexAttribDivisor(3 + column, 1);
+	}
+	glEnableVertexAttribArray(7);
+	glVertexAttribIPointer(7, 1, GL_UNSIGNED_INT, sizeof(SphereInstance), (void*)(offset + sizeof(glm::mat4)));
+	glVertexAttribDivisor(7, 1);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// count spheres in one draw, reading SphereInstances from instanceBuffer starting at offset
+void renderSpheresInstanced(unsigned int instanceBuffer, size_t offset, int count, int lod)
+{
+	bindSphereInstances(instanceBuffer, offset);
+
+	const SphereLod& mesh = sphereLods[lod];
+	glDrawElementsInstancedBaseVertex(GL_TRIANGLE_STRIP, mesh.indexCount, sphereIndexType, (void*)mesh.firstIndex, count, mesh.baseVertex);
+}
+
+// every command's baseInstance counts on from the SphereInstance at instanceOffset
+void renderSpheresIndirect(unsigned int instanceBuffer, size_t instanceOffset, unsigned int indirectBuffer, size_t indirectOffset, int drawCount)
+{
+	bindSphereInstances(instanceBuffer, instanceOffset);
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+	glMultiDrawElementsIndirect(GL_TRIANGLE_STRIP, sphereIndexType, (void*)indirectOffset, drawCount, 0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+DrawElementsIndirectCommand sphereIndirectCommand(int lod, int instanceCount, int baseInstance)
+{
+	if (sphereVAO == 0)
+	{
+		createSphere();
+	}
+
+	const SphereLod& mesh = sphereLods[lod];
+	DrawElementsIndirectCommand command;
+	command.count = mesh.indexCount;
+	command.instanceCount = instanceCount;
+	command.firstIndex = (unsigned int)(mesh.firstIndex / (sphereIndexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int)));
+	command.baseVertex = mesh.baseVertex;
+	command.baseInstance = baseInstance;
+	return command;
+}
+
+// the level a sphere covering screenRadius pixels wants, once it is clearly past the switching radius
+// on the other side of previousLod. A sphere sitting right on one stays put instead of flickering
+int selectSphereLod(float screenRadius, int previousLod)
+{
+	int lod = 0;
+	while (lod < sphereLodCount - 1 && screenRadius < sphereLodRadii[lod])
+	{
+		++lod;
+	}
+	if (previousLod < 0 || lod == previousLod)
+	{
+		return lod;
+	}
+
+	int coarser = 0;	// the level it would take if it were a little bigger, it has to want even that to drop
+	while (coarser < sphereLodCount - 1 && screenRadius * (1.0f + sphereLodHysteresis) < sphereLodRadii[coarser])
+	{
+		++coarser;
+	}
+	int finer = 0;		// and a little smaller to rise
+	while (finer < sphereLodCount - 1 && screenRadius * (1.0f - sphereLodHysteresis) < sphereLodRadii[finer])
+	{
+		++finer;
+	}
+
+	if (coarser > previousLod)
+	{
+		return coarser;
+	}
+	if (finer < previousLod)
+	{
+		return finer;
+	}
+	return previousLod;
+}
+
+int sphereLodIndexCount(int lod)
+{
+	if (sphereVAO == 0)
+	{
+		createSphere();
+	}
+	return sphereLods[lod].indexCount;
+}
+
+
+
+// CUBE
+//=====
+unsigned int cubeVAO = 0;
+unsigned int cubeVBO = 0;
+unsigned int cubeEBO = 0;
+// position, normal, texture coordinates: two triangles a face, 24 distinct vertices once they're indexed
+static const float cubeVertices[] = {
+	// back face
+	-1.0f, -1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 0.0f, 0.0f, // bottom-left
+	 1.0f,  1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 1.0f, 1.0f, // top-right
+	 1.0f, -1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 1.0f, 0.0f, // bottom-right         
+	 1.0f,  1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 1.0f, 1.0f, // top-right
+	-1.0f, -1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 0.0f, 0.0f, // bottom-left
+	-1.0f,  1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 0.0f, 1.0f, // top-left
+	// front face
+	-1.0f, -1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f, 0.0f, // bottom-left
+	 1.0f, -1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f, 0.0f, // bottom-right
+	 1.0f,  1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f, 1.0f, // top-right
+	 1.0f,  1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f, 1.0f, // top-right
+	-1.0f,  1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f, 1.0f, // top-left
+	-1.0f, -1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f, 0.0f, // bottom-left
+	// left face
+	-1.0f,  1.0f,  1.0f, -1.0f,  0.0f,  0.0f, 1.0f, 0.0f, // top-right
+	-1.0f,  1.0f, -1.0f, -1.0f,  0.0f,  0.0f, 1.0f, 1.0f, // top-left
+	-1.0f, -1.0f, -1.0f, -1.0f,  0.0f,  0.0f, 0.0f, 1.0f, // bottom-left
+	-1.0f, -1.0f, -1.0f, -1.0f,  0.0f,  0.0f, 0.0f, 1.0f, // bottom-left
+	-1.0f, -1.0f,  1.0f, -1.0f,  0.0f,  0.0f, 0.0f, 0.0f, // bottom-right
+	-1.0f,  1.0f,  1.0f, -1.0f,  0.0f,  0.0f, 1.0f, 0.0f, // top-right
+	// right face
+	 1.0f,  1.0f,  1.0f,  1.0f,  0.0f,  0.0f, 1.0f, 0.0f, // top-left
+	 1.0f, -1.0f, -1.0f,  1.0f,  0.0f,  0.0f, 0.0f, 1.0f, // bottom-right
+	 1.0f,  1.0f, -1.0f,  1.0f,  0.0f,  0.0f, 1.0f, 1.0f, // top-right         
+	 1.0f, -1.0f, -1.0f,  1.0f,  0.0f,  0.0f, 0.0f, 1.0f, // bottom-right
+	 1.0f,  1.0f,  1.0f,  1.0f,  0.0f,  0.0f, 1.0f, 0.0f, // top-left
+	 1.0f, -1.0f,  1.0f,  1.0f,  0.0f,  0.0f, 0.0f, 0.0f, // bottom-left     
+	// bottom face
+	-1.0f, -1.0f, -1.0f,  0.0f, -1.0f,  0.0f, 0.0f, 1.0f, // top-right
+	 1.0f, -1.0f, -1.0f,  0.0f, -1.0f,  0.0f, 1.0f, 1.0f, // top-left
+	 1.0f, -1.0f,  1.0f,  0.0f, -1.0f,  0.0f, 1.0f, 0.0f, // bottom-left
+	 1.0f, -1.0f,  1.0f,  0.0f, -1.0f,  0.0f, 1.0f, 0.0f, // bottom-left
+	-1.0f, -1.0f,  1.0f,  0.0f, -1.0f,  0.0f, 0.0f, 0.0f, // bottom-right
+	-1.0f, -1.0f, -1.0f,  0.0f, -1.0f,  0.0f, 0.0f, 1.0f, // top-right
+	// top face
+	-1.0f,  1.0f, -1.0f,  0.0f,  1.0f,  0.0f, 0.0f, 1.0f, // top-left
+	 1.0f,  1.0f , 1.0f,  0.0f,  1.0f,  0.0f, 1.0f, 0.0f, // bottom-right
+	 1.0f,  1.0f, -1.0f,  0.0f,  1.0f,  0.0f, 1.0f, 1.0f, // top-right     
+	 1.0f,  1.0f,  1.0f,  0.0f,  1.0f,  0.0f, 1.0f, 0.0f, // bottom-right
+	-1.0f,  1.0f, -1.0f,  0.0f,  1.0f,  0.0f, 0.0f, 1.0f, // top-left
+	-1.0f,  1.0f,  1.0f,  0.0f,  1.0f,  0.0f, 0.0f, 0.0f  // bottom-left        
+};
+void renderCube()
+{
+	if (cubeVAO == 0)
+	{
+		glm::vec3 positions[36], normals[36];
+		glm::vec2 texCoords[36];
+		glm::vec4 tangents[36];
+		unsigned short corners[36];
+		for (int i = 0; i < 36; ++i)
+		{
+			const float* v = &cubeVertices[i * 8];
+			positions[i] = glm::vec3(v[0], v[1], v[2]);
+			normals[i] = glm::vec3(v[3], v[4], v[5]);
+			texCoords[i] = glm::vec2(v[6], v[7]);
+			corners[i] = (unsigned short)i;
+		}
+		computeTangents(positions, texCoords, normals, 36, corners, 36, tangents);
+
+		PackedVertex vertices[36];
+		unsigned short indices[36];
+		int vertexCount = 0;
+		for (int i = 0; i < 36; ++i)
+		{
+			PackedVertex vertex = packVertex(positions[i], texCoords[i], normals[i], tangents[i]);
+			int found = 0;
+			while (found < vertexCount && memcmp(&vertices[found], &vertex, sizeof(PackedVertex)) != 0)
+			{
+				++found;
+			}
+			if (found == vertexCount)
+			{
+				vertices[vertexCount++] = vertex;
+			}
+			indices[i] = (unsigned short)found;
+		}
+
+		glGenVertexArrays(1, &cubeVAO);
+		glGenBuffers(1, &cubeVBO);
+		glGenBuffers(1, &cubeEBO);
+		// fill buffers
+		glBindVertexArray(cubeVAO);
+		glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
+		glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(PackedVertex), vertices, GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, cubeEBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+		// link vertex attributes
+		setPackedVertexFormat();
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindVertexArray(0);
+	}
+	// render Cube
+	glBindVertexArray(cubeVAO);
+	glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_SHORT, 0);
+	glBindVertexArray(0);
+}
+
+
+// QUAD
+//=====
+unsigned int quadVAO = 0;
+unsigned int quadVBO = 0;
+// full screen quad in NDC, used for 2D passes like the BRDF lookup table
+void renderQuad()
+{
+	if (quadVAO == 0)
+	{
+		float quadVertices[] = {
+			// positions        // texture Coords
+			-1.0f,  1.0f, 0.0f, 0.0f, 1.0f,
+			-1.0f, -1.0f, 0.0f, 0.0f, 0.0f,
+			 1.0f,  1.0f, 0.0f, 1.0f, 1.0f,
+			 1.0f, -1.0f, 0.0f, 1.0f, 0.0f,
+		};
+		glGenVertexArrays(1, &quadVAO);
+		glGenBuffers(1, &quadVBO);
+		glBindVertexArray(quadVAO);
+		glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+	glBindVertexArray(quadVAO);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	glBindVertexArray(0);
+}
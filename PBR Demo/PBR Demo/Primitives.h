@@ -0,0 +1,40 @@
+#ifndef PRIMITIVES_H
+#define PRIMITIVES_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+
+// per-instance sphere data, read as vertex attributes 3-6 (model matrix columns) and 7 (material layer)
+struct SphereInstance
+{
+	glm::mat4 model;
+	unsigned int material;
+};
+
+// one draw of glMultiDrawElementsIndirect, laid out as GL reads it
+struct DrawElementsIndirectCommand
+{
+	unsigned int count;
+	unsigned int instanceCount;
+	unsigned int firstIndex;
+	int baseVertex;
+	unsigned int baseInstance;
+};
+
+// the sphere mesh comes in sphereLodCount levels of detail, 0 is the finest. All of them share one
+// vertex and index buffer
+const int sphereLodCount = 4;
+
+void renderSphere(int lod = 0);									// one sphere using the values given to setSphereInstance
+void setSphereInstance(const SphereInstance& instance);
+void renderSpheresInstanced(unsigned int instanceBuffer, size_t offset, int count, int lod = 0);	// count spheres in one draw
+void renderSpheresIndirect(unsigned int instanceBuffer, size_t instanceOffset, unsigned int indirectBuffer, size_t indirectOffset, int drawCount);	// needs glCaps.multiDrawIndirect
+DrawElementsIndirectCommand sphereIndirectCommand(int lod, int instanceCount, int baseInstance);
+int selectSphereLod(float screenRadius, int previousLod);		// from the radius in pixels, previousLod -1 if there isn't one
+int sphereLodIndexCount(int lod);
+void renderCube();
+void renderQuad();
+#endif
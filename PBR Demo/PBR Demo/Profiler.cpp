@@ -0,0 +1,299 @@
+#include "Profiler.h"
+#include "GLCaps.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+
+
+Profiler profiler;
+
+// microseconds since the first call
+static double now()
+{
+	static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+
+//CONSTRUCTOR
+//============
+Profiler::Profiler(int historyLength)
+	: historyLength(historyLength), gpuScopeOpen(false), countFragments(false), frameStart(-1.0), framePass(-1), tracing(false)
+{
+}
+
+
+
+// FUNCTIONS
+//==========
+void Profiler::beginFrame()
+{
+	if (framePass < 0)
+	{
+		framePass = findPass("frame");
+	}
+	frameStart = now();
+}
+
+void Profiler::endFrame()
+{
+	if (frameStart >= 0.0)
+	{
+		record(framePass, false, frameStart, now() - frameStart);
+		frameStart = -1.0;
+	}
+
+	// results arrive in order, so stop at the first one that isn't ready
+	for (std::size_t i = 0; i < passes.size(); ++i)
+	{
+		for (int j = 0; j < queryRingSize; ++j)
+		{
+			int slot = (passes[i].nextQuery + j) % queryRingSize;
+			if (!passes[i].queryPending[slot])
+			{
+				continue;
+			}
+			GLint available = 0;
+			glGetQueryObjectiv(passes[i].queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available)
+			{
+				break;
+			}
+			collect((int)i, slot);
+		}
+	}
+}
+
+void Profiler::flush()
+{
+	for (std::size_t i = 0; i < passes.size(); ++i)
+	{
+		for (int j = 0; j < queryRingSize; ++j)
+		{
+			int slot = (passes[i].nextQuery + j) % queryRingSize;
+			if (passes[i].queryPending[slot])
+			{
+				collect((int)i, slot);
+			}
+		}
+	}
+}
+
+void Profiler::beginScope(const char* name, bool gpu)
+{
+	OpenScope scope;
+	scope.pass = findPass(name);
+	scope.query = -1;
+
+	if (gpu && !gpuScopeOpen)
+	{
+		Pass& pass = passes[scope.pass];
+		if (pass.queries[0] == 0)
+		{
+			glGenQueries(queryRingSize, pass.queries);
+		}
+
+		// the GPU is a whole ring behind, this is the only place the profiler waits
+		scope.query = pass.nextQuery;
+		pass.nextQuery = (pass.nextQuery + 1) % queryRingSize;
+		if (pass.queryPending[scope.query])
+		{
+			collect(scope.pass, scope.query);
+		}
+
+		gpuScopeOpen = true;
+		glBeginQuery(GL_TIME_ELAPSED, pass.queries[scope.query]);
+
+		pass.fragmentsCounted[scope.query] = countFragments;
+		if (countFragments)
+		{
+			if (pass.fragmentQueries[0] == 0)
+			{
+				glGenQueries(queryRingSize, pass.fragmentQueries);
+			}
+			glBeginQuery(GL_FRAGMENT_SHADER_INVOCATIONS, pass.fragmentQueries[scope.query]);
+		}
+	}
+
+	scope.start = now();
+	if (scope.query >= 0)
+	{
+		passes[scope.pass].queryStart[scope.query] = scope.start;
+	}
+	scopes.push_back(scope);
+}
+
+void Profiler::endScope()
+{
+	if (scopes.empty())
+	{
+		return;
+	}
+	OpenScope scope = scopes.back();
+	scopes.pop_back();
+
+	if (scope.query >= 0)
+	{
+		glEndQuery(GL_TIME_ELAPSED);
+		if (passes[scope.pass].fragmentsCounted[scope.query])
+		{
+			glEndQuery(GL_FRAGMENT_SHADER_INVOCATIONS);
+		}
+		passes[scope.pass].queryPending[scope.query] = true;
+		gpuScopeOpen = false;
+	}
+	record(scope.pass, false, scope.start, now() - scope.start);
+}
+
+void Profiler::setTracing(bool tracing)
+{
+	this->tracing = tracing;
+}
+
+void Profiler::setPipelineStatistics(bool counting)
+{
+	countFragments = counting && glCaps.pipelineStatistics;
+}
+
+// CPU events on one track, GPU events on another. GPU events start where their CPU scope did,
+// elapsed time queries only say how long the GPU took, not when it started
+bool Profiler::writeChromeTrace(const std::string& path) const
+{
+	std::ofstream file(path.c_str());
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+
+	char line[256];
+	for (std::size_t i = 0; i < trace.size(); ++i)
+	{
+		const TraceEvent& event = trace[i];
+		snprintf(line, sizeof(line), ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+			passes[event.pass].name.c_str(), event.gpu ? "gpu" : "cpu", event.gpu ? 2 : 1, event.start, event.duration);
+		file << line;
+	}
+	file << "\n]}\n";
+	return file.good();
+}
+
+void Profiler::printSummary(std::ostream& out, const std::string& prefix) const
+{
+	char line[256];
+	for (std::size_t i = 0; i < passes.size(); ++i)
+	{
+		const Pass& pass = passes[i];
+		if (pass.name.compare(0, prefix.size(), prefix) != 0 || pass.cpu.count == 0)
+		{
+			continue;
+		}
+
+		float minimum, average, p99;
+		pass.cpu.summarise(minimum, average, p99);
+		int length = snprintf(line, sizeof(line), "%-28s CPU %8.3f min %8.3f avg %8.3f p99 ms", pass.name.c_str(), minimum, average, p99);
+		if (pass.gpu.count > 0)
+		{
+			pass.gpu.summarise(minimum, average, p99);
+			length += snprintf(line + length, sizeof(line) - length, " | GPU %8.3f min %8.3f avg %8.3f p99 ms", minimum, average, p99);
+		}
+		if (pass.fragments.count > 0)
+		{
+			pass.fragments.summarise(minimum, average, p99);
+			snprintf(line + length, sizeof(line) - length, " | FS %10.0f avg invocations", average);
+		}
+		out << line << std::endl;
+	}
+}
+
+// pass names are string literals, there are only ever a handful
+int Profiler::findPass(const char* name)
+{
+	for (std::size_t i = 0; i < passes.size(); ++i)
+	{
+		if (passes[i].name == name)
+		{
+			return (int)i;
+		}
+	}
+
+	Pass pass;
+	pass.name = name;
+	pass.cpu.samples.resize(historyLength);
+	pass.gpu.samples.resize(historyLength);
+	pass.fragments.samples.resize(historyLength);
+	for (int i = 0; i < queryRingSize; ++i)
+	{
+		pass.queries[i] = 0;
+		pass.fragmentQueries[i] = 0;
+		pass.queryPending[i] = false;
+		pass.fragmentsCounted[i] = false;
+		pass.queryStart[i] = 0.0;
+	}
+	passes.push_back(pass);
+	return (int)passes.size() - 1;
+}
+
+// blocks if the result hasn't arrived yet
+void Profiler::collect(int pass, int slot)
+{
+	GLuint64 elapsed = 0;
+	glGetQueryObjectui64v(passes[pass].queries[slot], GL_QUERY_RESULT, &elapsed);
+	passes[pass].queryPending[slot] = false;
+	record(pass, true, passes[pass].queryStart[slot], elapsed / 1000.0);
+
+	if (passes[pass].fragmentsCounted[slot])
+	{
+		GLuint64 invocations = 0;
+		glGetQueryObjectui64v(passes[pass].fragmentQueries[slot], GL_QUERY_RESULT, &invocations);
+		passes[pass].fragments.add((float)invocations);
+	}
+}
+
+void Profiler::record(int pass, bool gpu, double start, double duration)
+{
+	(gpu ? passes[pass].gpu : passes[pass].cpu).add((float)(duration / 1000.0));
+
+	if (tracing && (int)trace.size() < maxTraceEvents)
+	{
+		TraceEvent event = { pass, gpu, start, duration };
+		trace.push_back(event);
+	}
+}
+
+void Profiler::History::add(float ms)
+{
+	samples[next] = ms;
+	next = (next + 1) % (int)samples.size();
+	count = std::min(count + 1, (int)samples.size());
+}
+
+void Profiler::History::summarise(float& minimum, float& average, float& p99) const
+{
+	std::vector<float> sorted(samples.begin(), samples.begin() + count);
+	std::sort(sorted.begin(), sorted.end());
+
+	float total = 0.0f;
+	for (std::size_t i = 0; i < sorted.size(); ++i)
+	{
+		total += sorted[i];
+	}
+	minimum = sorted.front();
+	average = total / sorted.size();
+	p99 = sorted[std::min(sorted.size() - 1, (std::size_t)(sorted.size() * 0.99f))];
+}
+
+
+
+// SCOPE
+//======
+ProfileScope::ProfileScope(Profiler& profiler, const char* name, bool gpu)
+	: profiler(profiler)
+{
+	profiler.beginScope(name, gpu);
+}
+
+ProfileScope::~ProfileScope()
+{
+	profiler.endScope();
+}
@@ -0,0 +1,102 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+#include <iostream>
+
+
+// Per-pass CPU and GPU timings. Every named pass keeps a rolling history for min/avg/p99 summaries
+// and a small ring of GL_TIME_ELAPSED queries that are read back a few frames later, so timing
+// the GPU never stalls the pipeline. Events can also be kept for a Chrome trace (chrome://tracing).
+// GL_TIME_ELAPSED queries can't nest: a GPU scope opened inside another one only times the CPU.
+// GPU scopes can also count fragment shader invocations alongside the timing, where the driver
+// has pipeline statistics queries.
+// The queries are never deleted, they go with the GL context.
+class Profiler
+{
+public:
+	Profiler(int historyLength = 300);	// samples kept per pass
+
+	void beginFrame();
+	void endFrame();				// reads back any GPU timings that have arrived
+	void flush();					// waits for every outstanding GPU timing
+
+	void beginScope(const char* name, bool gpu = true);
+	void endScope();
+
+	void setTracing(bool tracing);	// keep every event for writeChromeTrace(), off by default
+	void setPipelineStatistics(bool counting);	// count fragment shader invocations per GPU scope, off by default
+	bool writeChromeTrace(const std::string& path) const;
+
+	void printSummary(std::ostream& out = std::cout, const std::string& prefix = "") const;	// passes whose names start with prefix
+
+private:
+	static const int queryRingSize = 4;		// frames a GPU timing may lag behind before beginScope waits for it
+	static const int maxTraceEvents = 1000000;
+
+	struct History
+	{
+		std::vector<float> samples;		// milliseconds, ring
+		int next = 0;
+		int count = 0;
+
+		void add(float ms);
+		void summarise(float& minimum, float& average, float& p99) const;
+	};
+	struct Pass
+	{
+		std::string name;
+		History cpu, gpu;
+		History fragments;				// shader invocations, not milliseconds
+		unsigned int queries[queryRingSize];
+		unsigned int fragmentQueries[queryRingSize];
+		bool queryPending[queryRingSize];
+		bool fragmentsCounted[queryRingSize];
+		double queryStart[queryRingSize];		// CPU time the query began, places the GPU event in the trace
+		int nextQuery = 0;
+	};
+	struct OpenScope
+	{
+		int pass;
+		double start;
+		int query;						// ring slot, -1 for CPU only
+	};
+	struct TraceEvent
+	{
+		int pass;
+		bool gpu;
+		double start, duration;			// microseconds since the profiler was created
+	};
+
+	int historyLength;
+	std::vector<Pass> passes;
+	std::vector<OpenScope> scopes;
+	bool gpuScopeOpen;
+	bool countFragments;
+	double frameStart;
+	int framePass;
+
+	bool tracing;
+	std::vector<TraceEvent> trace;
+
+	int findPass(const char* name);
+	void collect(int pass, int slot);
+	void record(int pass, bool gpu, double start, double duration);
+};
+
+// times everything until the end of the enclosing block
+class ProfileScope
+{
+public:
+	ProfileScope(Profiler& profiler, const char* name, bool gpu = true);
+	~ProfileScope();
+
+private:
+	Profiler& profiler;
+};
+
+extern Profiler profiler;
+#endif
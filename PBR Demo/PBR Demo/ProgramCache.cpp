@@ -0,0 +1,209 @@
+#include "ProgramCache.h"
+#include "GLCaps.h"
+#include "Hash.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <io.h>
+#else
+#include <sys/stat.h>
+#include <dirent.h>
+#endif
+
+
+// every *.programcache in the cache directory, directory included
+static std::vector<std::string> listCacheFiles()
+{
+	std::vector<std::string> files;
+	const std::string suffix = ".programcache";
+#ifdef _WIN32
+	_finddata_t found;
+	intptr_t search = _findfirst((std::string(programCacheDirectory) + "*" + suffix).c_str(), &found);
+	if (search == -1)
+	{
+		return files;
+	}
+	do
+	{
+		files.push_back(std::string(programCacheDirectory) + found.name);
+	} while (_findnext(search, &found) == 0);
+	_findclose(search);
+#else
+	DIR* directory = opendir(programCacheDirectory);
+	if (!directory)
+	{
+		return files;
+	}
+	for (dirent* entry = readdir(directory); entry != NULL; entry = readdir(directory))
+	{
+		std::string name = entry->d_name;
+		if (name.size() > suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0)
+		{
+			files.push_back(std::string(programCacheDirectory) + name);
+		}
+	}
+	closedir(directory);
+#endif
+	return files;
+}
+
+static bool fileExists(const std::string& path)
+{
+	return std::ifstream(path.c_str()).good();
+}
+
+// the file's sources, false if it isn't a cache file of this version
+static bool readSourcePaths(const std::string& path, std::string& vertexPath, std::string& fragmentPath)
+{
+	MappedFile file(path);
+	if (!file.isOpen() || file.size() < sizeof(ProgramCacheHeader))
+	{
+		return false;
+	}
+	const ProgramCacheHeader* header = (const ProgramCacheHeader*)file.data();
+	if (memcmp(header->magic, "PBIN", 4) != 0 || header->version != programCacheVersion || header->pathsSize > file.size() - sizeof(ProgramCacheHeader))
+	{
+		return false;
+	}
+
+	const char* paths = (const char*)file.data() + sizeof(ProgramCacheHeader);
+	std::size_t vertexLength = strnlen(paths, header->pathsSize);
+	if (vertexLength >= header->pathsSize)
+	{
+		return false;
+	}
+	vertexPath.assign(paths, vertexLength);
+	fragmentPath.assign(paths + vertexLength + 1, strnlen(paths + vertexLength + 1, header->pathsSize - vertexLength - 1));
+	return true;
+}
+
+// files a past run left behind: other versions, and programs whose shaders were deleted or renamed
+static void pruneProgramCache()
+{
+	std::vector<std::string> files = listCacheFiles();
+	for (std::size_t i = 0; i < files.size(); ++i)
+	{
+		std::string vertexPath, fragmentPath;
+		if (!readSourcePaths(files[i], vertexPath, fragmentPath) || !fileExists(vertexPath) || !fileExists(fragmentPath))
+		{
+			std::remove(files[i].c_str());
+		}
+	}
+}
+
+
+
+// FUNCTIONS
+//==========
+std::string programCachePath(const char* vertexPath, const char* fragmentPath, const std::vector<std::string>& defines)
+{
+	std::uint64_t hash = hashBytes(vertexPath, strlen(vertexPath));
+	for (std::size_t i = 0; i < defines.size(); ++i)
+	{
+		hash = hashBytes(" ", 1, hash);		// keeps { "AB" } apart from { "A", "B" }
+		hash = hashBytes(defines[i].data(), defines[i].size(), hash);
+	}
+
+	const char* slash = strrchr(fragmentPath, '/');
+	const char* backslash = strrchr(fragmentPath, '\\');
+	const char* fileName = std::max(slash ? slash + 1 : fragmentPath, backslash ? backslash + 1 : fragmentPath);
+
+	char name[32];
+	snprintf(name, sizeof(name), ".%08x.programcache", (unsigned int)(hash ^ (hash >> 32)));
+	return std::string(programCacheDirectory) + fileName + name;
+}
+
+std::uint64_t hashProgramSources(const std::string& vertexCode, const std::string& fragmentCode)
+{
+	std::uint64_t hash = hashBytes(vertexCode.data(), vertexCode.size());
+	hash = hashBytes(fragmentCode.data(), fragmentCode.size(), hash);
+
+	const char* driverStrings[2] = { (const char*)glGetString(GL_RENDERER), (const char*)glGetString(GL_VERSION) };
+	for (int i = 0; i < 2; ++i)
+	{
+		if (driverStrings[i] != NULL)
+		{
+			hash = hashBytes(driverStrings[i], strlen(driverStrings[i]) + 1, hash);
+		}
+	}
+	return hash;
+}
+
+bool loadProgramCache(const std::string& path, std::uint64_t hash, unsigned int program)
+{
+	MappedFile file(path);
+	if (!file.isOpen() || file.size() < sizeof(ProgramCacheHeader))
+	{
+		return false;
+	}
+
+	const ProgramCacheHeader* header = (const ProgramCacheHeader*)file.data();
+	if (memcmp(header->magic, "PBIN", 4) != 0 || header->version != programCacheVersion || header->hash != hash)
+	{
+		return false;
+	}
+	std::size_t available = file.size() - sizeof(ProgramCacheHeader);
+	if (header->pathsSize > available || header->binarySize == 0 || header->binarySize > available - header->pathsSize)
+	{
+		return false;
+	}
+
+	// the driver checks the binary itself and fails the link if it won't take it
+	glProgramBinary(program, header->binaryFormat, file.data() + sizeof(ProgramCacheHeader) + header->pathsSize, header->binarySize);
+	int success = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	return success != 0;
+}
+
+bool saveProgramCache(const std::string& path, std::uint64_t hash, unsigned int program, const std::string& vertexPath, const std::string& fragmentPath)
+{
+	static bool pruned = false;
+	if (!pruned)
+	{
+		pruned = true;
+#ifdef _WIN32
+		_mkdir(programCacheDirectory);
+#else
+		mkdir(programCacheDirectory, 0755);
+#endif
+		pruneProgramCache();
+	}
+
+	int binarySize = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binarySize);
+	if (binarySize <= 0)
+	{
+		return false;
+	}
+
+	std::vector<unsigned char> binary(binarySize);
+	GLenum binaryFormat = 0;
+	glGetProgramBinary(program, binarySize, &binarySize, &binaryFormat, &binary[0]);
+	if (binarySize <= 0)
+	{
+		return false;
+	}
+
+	ProgramCacheHeader header;
+	memcpy(header.magic, "PBIN", 4);
+	header.version = programCacheVersion;
+	header.hash = hash;
+	header.binaryFormat = binaryFormat;
+	header.binarySize = (std::uint32_t)binarySize;
+
+	std::string paths = vertexPath + '\0' + fragmentPath + '\0';
+	header.pathsSize = (std::uint32_t)paths.size();
+	header.padding = 0;
+
+	std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+	file.write((const char*)&header, sizeof(header));
+	file.write(paths.data(), paths.size());
+	file.write((const char*)&binary[0], binarySize);
+	return file.good();
+}
@@ -0,0 +1,46 @@
+#ifndef PROGRAMCACHE_H
+#define PROGRAMCACHE_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+// PROGRAM BINARY CACHE
+//=====================
+// Linked programs are saved with glGetProgramBinary into programCacheDirectory, one file each: a header,
+// the two source paths, then the driver's binary as it came. Later runs hand it back with glProgramBinary
+// and skip compiling and linking. A program's file is rewritten whenever it is saved, and the first save
+// of a run deletes any file written by another cache version or built from a shader that no longer exists. The hash covers both stages' source with their includes and defines, and the
+// GL_RENDERER and GL_VERSION strings, so an edited shader or include or a driver update makes the file stale;
+// the driver may still reject a binary it wrote, the program is then built from source again.
+
+const std::uint32_t programCacheVersion = 2;	// bump when the layout changes
+const char* const programCacheDirectory = "shadercache/";	// relative to the working directory, like the shaders
+
+struct ProgramCacheHeader
+{
+	char magic[4];					// "PBIN"
+	std::uint32_t version;
+	std::uint64_t hash;
+	std::uint32_t binaryFormat;		// as glGetProgramBinary reported it
+	std::uint32_t binarySize;		// bytes following the paths
+	std::uint32_t pathsSize;		// vertex then fragment path, each null terminated, straight after the header
+	std::uint32_t padding;
+};
+
+// one file per vertex shader, fragment shader and define set
+std::string programCachePath(const char* vertexPath, const char* fragmentPath, const std::vector<std::string>& defines);
+
+// the sources as compiled, defines included, and the driver that compiled them
+std::uint64_t hashProgramSources(const std::string& vertexCode, const std::string& fragmentCode);
+
+// false if the file is missing, stale, malformed or the driver rejects the binary, program is then left unlinked
+bool loadProgramCache(const std::string& path, std::uint64_t hash, unsigned int program);
+
+// program must be linked, with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set first. false if nothing was written
+bool saveProgramCache(const std::string& path, std::uint64_t hash, unsigned int program, const std::string& vertexPath, const std::string& fragmentPath);
+
+#endif
@@ -0,0 +1,252 @@
+#include "RenderQueue.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <iostream>
+
+
+DrawCommand DrawCommand::spheres(unsigned int instanceBuffer, size_t offset, int count, int lod)
+{
+	DrawCommand command = DrawCommand();
+	command.kind = SPHERES_INSTANCED;
+	command.instanceBuffer = instanceBuffer;
+	command.offset = offset;
+	command.count = count;
+	command.lod = lod;
+	return command;
+}
+
+DrawCommand DrawCommand::spheresIndirect(unsigned int instanceBuffer, size_t offset, unsigned int indirectBuffer, size_t indirectOffset, int count)
+{
+	DrawCommand command = DrawCommand();
+	command.kind = SPHERES_INDIRECT;
+	command.instanceBuffer = instanceBuffer;
+	command.offset = offset;
+	command.indirectBuffer = indirectBuffer;
+	command.indirectOffset = indirectOffset;
+	command.count = count;
+	return command;
+}
+
+DrawCommand DrawCommand::sphere(const SphereInstance& instance, int lod)
+{
+	DrawCommand command = DrawCommand();
+	command.kind = SPHERE;
+	command.instance = instance;
+	command.lod = lod;
+	return command;
+}
+
+DrawCommand DrawCommand::quad()
+{
+	DrawCommand command = DrawCommand();
+	command.kind = QUAD;
+	return command;
+}
+
+DrawCommand DrawCommand::cube()
+{
+	DrawCommand command = DrawCommand();
+	command.kind = CUBE;
+	return command;
+}
+
+
+//CONSTRUCTOR
+//============
+RenderQueue::RenderQueue(float farDistance)
+	: farDistance(farDistance), lastProgramChanges(0), lastBindingChanges(0)
+{
+	bindings.push_back(std::function<void()>());	// noBindings
+}
+
+
+
+// FUNCTIONS
+//==========
+void RenderQueue::setPass(int pass, const RenderPass& description)
+{
+	passes[pass] = description;
+}
+
+int RenderQueue::addProgram(unsigned int program)
+{
+	if ((int)programs.size() == maxPrograms)
+	{
+		std::cout << "ERROR::RENDERQUEUE::TOO_MANY_PROGRAMS: " << maxPrograms << " fit in the sort key" << std::endl;
+		return -1;
+	}
+	programs.push_back(program);
+	return (int)programs.size() - 1;
+}
+
+void RenderQueue::setProgram(int program, unsigned int replacement)
+{
+	programs[program] = replacement;
+}
+
+int RenderQueue::addBindings(const std::function<void()>& bind)
+{
+	if ((int)bindings.size() == maxBindings)
+	{
+		std::cout << "ERROR::RENDERQUEUE::TOO_MANY_BINDINGS: " << maxBindings << " fit in the sort key" << std::endl;
+		return -1;
+	}
+	bindings.push_back(bind);
+	return (int)bindings.size() - 1;
+}
+
+void RenderQueue::clear()
+{
+	packets.clear();
+}
+
+void RenderQueue::submit(int pass, int program, int bindingSet, float depth, const DrawCommand& command)
+{
+	if (program < 0 || program >= (int)programs.size() || bindingSet < 0 || bindingSet >= (int)bindings.size())
+	{
+		return;		// never registered, or registering failed
+	}
+
+	const std::uint64_t depthMax = (1 << 24) - 1;
+	std::uint64_t depthBits = (std::uint64_t)(std::min(std::max(depth / farDistance, 0.0f), 1.0f) * depthMax);
+
+	Packet packet;
+	packet.key = ((std::uint64_t)pass << 60) | ((std::uint64_t)program << 52) | ((std::uint64_t)bindingSet << 44) | (depthBits << 20) | (packets.size() & 0xFFFFF);
+	packet.program = program;
+	packet.bindings = bindingSet;
+	packet.command = command;
+	packets.push_back(packet);
+}
+
+void RenderQueue::execute()
+{
+	order.resize(packets.size());
+	for (std::size_t i = 0; i < packets.size(); ++i)
+	{
+		order[i].key = packets[i].key;
+		order[i].packet = (int)i;
+	}
+	radixSort();
+
+	int pass = -1, program = -1, bindingSet = -1;
+	lastProgramChanges = lastBindingChanges = 0;
+	for (std::size_t i = 0; i < order.size(); ++i)
+	{
+		const Packet& packet = packets[order[i].packet];
+		int packetPass = (int)(packet.key >> 60);
+		if (packetPass != pass)
+		{
+			if (pass >= 0)
+			{
+				profiler.endScope();
+			}
+			pass = packetPass;
+			const RenderPass& description = passes[pass];
+			profiler.beginScope(description.name.c_str());
+			if (description.begin)
+			{
+				description.begin();
+			}
+			glDepthFunc(description.depthFunc);
+			glDepthMask(description.depthWrite ? GL_TRUE : GL_FALSE);
+			GLboolean colour = description.colourWrite ? GL_TRUE : GL_FALSE;
+			glColorMask(colour, colour, colour, colour);
+		}
+		if (packet.program != program)
+		{
+			program = packet.program;
+			glUseProgram(programs[program]);
+			++lastProgramChanges;
+		}
+		if (packet.bindings != bindingSet)
+		{
+			bindingSet = packet.bindings;
+			if (bindings[bindingSet])
+			{
+				bindings[bindingSet]();
+			}
+			++lastBindingChanges;
+		}
+		draw(packet.command);
+	}
+	if (pass >= 0)
+	{
+		profiler.endScope();
+	}
+
+	glDepthFunc(GL_LEQUAL);
+	glDepthMask(GL_TRUE);
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
+
+int RenderQueue::packetCount() const
+{
+	return (int)packets.size();
+}
+
+int RenderQueue::programChanges() const
+{
+	return lastProgramChanges;
+}
+
+int RenderQueue::bindingChanges() const
+{
+	return lastBindingChanges;
+}
+
+// least significant byte first, each pass a stable counting sort into the other buffer. Bytes every
+// key has the same value in (most of the depth bits in a small scene, the pass bits within a pass)
+// would leave the order as it is and are skipped
+void RenderQueue::radixSort()
+{
+	scratch.resize(order.size());
+	for (int shift = 0; shift < 64; shift += 8)
+	{
+		std::size_t counts[256] = { 0 };
+		for (std::size_t i = 0; i < order.size(); ++i)
+		{
+			++counts[(order[i].key >> shift) & 0xFF];
+		}
+		if (order.empty() || counts[(order[0].key >> shift) & 0xFF] == order.size())
+		{
+			continue;
+		}
+
+		std::size_t offsets[256];
+		std::size_t total = 0;
+		for (int digit = 0; digit < 256; ++digit)
+		{
+			offsets[digit] = total;
+			total += counts[digit];
+		}
+		for (std::size_t i = 0; i < order.size(); ++i)
+		{
+			scratch[offsets[(order[i].key >> shift) & 0xFF]++] = order[i];
+		}
+		order.swap(scratch);
+	}
+}
+
+void RenderQueue::draw(const DrawCommand& command)
+{
+	switch (command.kind)
+	{
+	case DrawCommand::SPHERES_INSTANCED:
+		renderSpheresInstanced(command.instanceBuffer, command.offset, command.count, command.lod);
+		break;
+	case DrawCommand::SPHERES_INDIRECT:
+		renderSpheresIndirect(command.instanceBuffer, command.offset, command.indirectBuffer, command.indirectOffset, command.count);
+		break;
+	case DrawCommand::SPHERE:
+		setSphereInstance(command.instance);
+		renderSphere(command.lod);
+		break;
+	case DrawCommand::QUAD:
+		renderQuad();
+		break;
+	case DrawCommand::CUBE:
+		renderCube();
+		break;
+	}
+}
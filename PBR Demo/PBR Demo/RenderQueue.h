@@ -0,0 +1,108 @@
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#include <glad/glad.h>
+
+#include <Primitives.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+
+// what a packet draws, with the primitives in Primitives.h
+struct DrawCommand
+{
+	enum Kind
+	{
+		SPHERES_INSTANCED,	// count spheres from instanceBuffer at offset
+		SPHERES_INDIRECT,	// count commands from indirectBuffer at indirectOffset, instances from instanceBuffer at offset
+		SPHERE,				// one sphere with instance as its constant attributes
+		QUAD,
+		CUBE
+	};
+
+	Kind kind;
+	int lod;
+	int count;
+	unsigned int instanceBuffer;
+	size_t offset;
+	unsigned int indirectBuffer;
+	size_t indirectOffset;
+	SphereInstance instance;
+
+	static DrawCommand spheres(unsigned int instanceBuffer, size_t offset, int count, int lod);
+	static DrawCommand spheresIndirect(unsigned int instanceBuffer, size_t offset, unsigned int indirectBuffer, size_t indirectOffset, int count);
+	static DrawCommand sphere(const SphereInstance& instance, int lod);
+	static DrawCommand quad();
+	static DrawCommand cube();
+};
+
+// fixed function state a pass sets up, and anything else that has to happen as it starts
+struct RenderPass
+{
+	std::string name;					// profiler scope
+	GLenum depthFunc = GL_LEQUAL;
+	bool depthWrite = true;
+	bool colourWrite = true;
+	std::function<void()> begin;		// optional, e.g. switching framebuffer
+};
+
+// Draws are submitted as packets in any order and executed sorted by a 64 bit key:
+//	63-60 pass, 59-52 program, 51-44 bindings, 43-20 depth (nearest first), 19-0 submission order
+// so every pass runs in order, and within a pass programs and texture bindings only change when
+// they have to. Programs and bindings are registered once, up front, and referred to by index;
+// a bindings entry is a function that binds a whole set of textures. Past maxPrograms or maxBindings
+// the index wouldn't fit its key field, so registering fails with -1 and submit() drops any draw using it.
+// The keys are radix sorted, 8 bits a pass, skipping any byte every key shares.
+class RenderQueue
+{
+public:
+	static const int maxPasses = 16;
+	static const int maxPrograms = 256;
+	static const int maxBindings = 256;
+	static const int noBindings = 0;	// always registered, binds nothing
+
+	RenderQueue(float farDistance = 100.0f);	// depths are quantised over [0, farDistance]
+
+	void setPass(int pass, const RenderPass& description);
+	int addProgram(unsigned int program);		// -1 once maxPrograms are registered
+	void setProgram(int program, unsigned int replacement);		// e.g. once a program that was standing in has its own ready
+	int addBindings(const std::function<void()>& bind);		// -1 once maxBindings are registered
+
+	void clear();
+	void submit(int pass, int program, int bindings, float depth, const DrawCommand& command);
+	void execute();		// leaves depth test LEQUAL with depth and colour writes on
+
+	int packetCount() const;
+	int programChanges() const;		// in the last execute()
+	int bindingChanges() const;
+
+private:
+	struct Packet
+	{
+		std::uint64_t key;
+		int program;
+		int bindings;
+		DrawCommand command;
+	};
+	struct SortEntry
+	{
+		std::uint64_t key;
+		int packet;
+	};
+
+	float farDistance;
+	RenderPass passes[maxPasses];
+	std::vector<unsigned int> programs;
+	std::vector<std::function<void()> > bindings;
+
+	std::vector<Packet> packets;
+	std::vector<SortEntry> order, scratch;
+	int lastProgramChanges, lastBindingChanges;
+
+	void radixSort();
+	static void draw(const DrawCommand& command);
+};
+#endif
@@ -0,0 +1,81 @@
+#include "RingBuffer.h"
+#include "GLCaps.h"
+
+
+//CONSTRUCTOR
+//============
+RingBuffer::RingBuffer(GLenum target, size_t size, size_t alignment, int regionCount)
+	: target(target), bufferID(0), regionCount(regionCount), region(0), mapped(NULL), fences(regionCount, (GLsync)0)
+{
+	regionSize = (size + alignment - 1) / alignment * alignment;	// every region has to start on an aligned offset
+
+	glGenBuffers(1, &bufferID);
+	glBindBuffer(target, bufferID);
+	if (glCaps.bufferStorage)
+	{
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(target, regionSize * regionCount, NULL, flags);
+		mapped = (unsigned char*)glMapBufferRange(target, 0, regionSize * regionCount, flags);
+	}
+	else
+	{
+		glBufferData(target, regionSize * regionCount, NULL, GL_DYNAMIC_DRAW);
+		staging.resize(regionSize);
+	}
+	glBindBuffer(target, 0);
+}
+
+
+
+// FUNCTIONS
+//==========
+void* RingBuffer::begin()
+{
+	if (fences[region])
+	{
+		// normally signalled long ago, regionCount frames have passed since it was written
+		GLenum status = glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		while (status == GL_TIMEOUT_EXPIRED)
+		{
+			status = glClientWaitSync(fences[region], 0, 1000000);
+		}
+		glDeleteSync(fences[region]);
+		fences[region] = 0;
+	}
+
+	return mapped ? mapped + offset() : &staging[0];
+}
+
+void RingBuffer::end(size_t bytesWritten)
+{
+	if (!mapped && bytesWritten > 0)
+	{
+		glBindBuffer(target, bufferID);
+		glBufferSubData(target, offset(), bytesWritten, &staging[0]);
+		glBindBuffer(target, 0);
+	}
+}
+
+void RingBuffer::fence()
+{
+	if (mapped)
+	{
+		fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+	region = (region + 1) % regionCount;
+}
+
+unsigned int RingBuffer::buffer() const
+{
+	return bufferID;
+}
+
+size_t RingBuffer::offset() const
+{
+	return region * regionSize;
+}
+
+size_t RingBuffer::size() const
+{
+	return regionSize;
+}
@@ -0,0 +1,38 @@
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <vector>
+
+
+// A buffer split into regionCount equal regions for data that is rewritten every frame. Each frame
+// writes one region and fence() moves on to the next, so the CPU only waits if the GPU is still
+// reading a region from regionCount frames ago. The regions are persistently mapped when buffer
+// storage is available, otherwise writes go to a CPU copy that end() uploads with glBufferSubData.
+class RingBuffer
+{
+public:
+	RingBuffer(GLenum target, size_t size, size_t alignment = 1, int regionCount = 3);	// size of one region
+
+	void* begin();							// wait for the current region to be free and return a write pointer to it
+	void end(size_t bytesWritten);			// make the writes visible to the GPU
+	void fence();							// call once the draws reading the current region are issued
+
+	unsigned int buffer() const;
+	size_t offset() const;					// of the current region, for glBindBufferRange/attribute offsets
+	size_t size() const;					// of one region
+
+private:
+	GLenum target;
+	unsigned int bufferID;
+	size_t regionSize;
+	int regionCount;
+	int region;
+
+	unsigned char* mapped;					// NULL without buffer storage
+	std::vector<unsigned char> staging;		// used instead of the mapping
+	std::vector<GLsync> fences;
+};
+#endif
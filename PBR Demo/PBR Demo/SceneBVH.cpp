@@ -0,0 +1,285 @@
+#include "SceneBVH.h"
+
+#include <xmmintrin.h>
+
+#include <algorithm>
+
+
+// the box of an empty slot, outside of every plane
+static const float emptyMin = 1e30f;
+static const float emptyMax = -1e30f;
+
+// nth_element on the longest axis of the centres, everything before nth ends up on one side of it
+static void splitRange(std::vector<int>& order, int first, int count, int nth, const std::vector<glm::vec3>& centres)
+{
+	glm::vec3 low(emptyMin), high(emptyMax);
+	for (int i = first; i < first + count; ++i)
+	{
+		low = glm::min(low, centres[order[i]]);
+		high = glm::max(high, centres[order[i]]);
+	}
+	glm::vec3 extent = high - low;
+	int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+
+	std::nth_element(order.begin() + first, order.begin() + nth, order.begin() + first + count, [&centres, axis](int a, int b)
+	{
+		return centres[a][axis] < centres[b][axis];
+	});
+}
+
+
+//CONSTRUCTOR
+//============
+SceneBVH::SceneBVH()
+	: dirty(false), visibleObjects(0), testedNodes(0)
+{
+}
+
+
+
+// FUNCTIONS
+//==========
+void SceneBVH::build(const std::vector<CullBounds>& bounds)
+{
+	objects = bounds;
+	nodes.clear();
+	if (objects.empty())
+	{
+		return;
+	}
+
+	std::vector<glm::vec3> centres(objects.size());
+	buildOrder.resize(objects.size());
+	for (std::size_t i = 0; i < objects.size(); ++i)
+	{
+		centres[i] = (objects[i].min + objects[i].max) * 0.5f;
+		buildOrder[i] = (int)i;
+	}
+	nodes.reserve(objects.size() / 3 + 1);
+	buildNode(0, (int)objects.size(), centres);
+
+	dirty = true;
+	refit();
+}
+
+void SceneBVH::setBounds(int object, const CullBounds& bounds)
+{
+	objects[object] = bounds;
+	dirty = true;
+}
+
+// children come after their parents, so walking backwards finishes every child's box before its parent reads it
+void SceneBVH::refit()
+{
+	if (!dirty)
+	{
+		return;
+	}
+	for (int i = (int)nodes.size() - 1; i >= 0; --i)
+	{
+		for (int slot = 0; slot < 4; ++slot)
+		{
+			setSlot(nodes[i], slot, nodes[i].children[slot]);
+		}
+	}
+	dirty = false;
+}
+
+// planes from the rows of viewProjection (Gribb/Hartmann), each box tested against a plane by the
+// corner furthest along its normal: if even that is behind the plane the box is outside. The
+// nearest corner being in front of all six means the box is entirely inside
+void SceneBVH::cull(const glm::mat4& viewProjection, std::vector<int>& visible)
+{
+	visible.clear();
+	testedNodes = 0;
+	if (nodes.empty())
+	{
+		visibleObjects = 0;
+		return;
+	}
+
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; ++i)
+	{
+		rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+	}
+	const glm::vec4 planes[6] = { rows[3] + rows[0], rows[3] - rows[0], rows[3] + rows[1], rows[3] - rows[1], rows[3] + rows[2], rows[3] - rows[2] };
+
+	stack.clear();
+	stack.push_back(0);
+	while (!stack.empty())
+	{
+		const Node& node = nodes[stack.back()];
+		stack.pop_back();
+		++testedNodes;
+
+		__m128 outside = _mm_setzero_ps();
+		__m128 crossing = _mm_setzero_ps();
+		for (int i = 0; i < 6; ++i)
+		{
+			const glm::vec4& plane = planes[i];
+			__m128 farX = _mm_load_ps(plane.x >= 0.0f ? node.maxX : node.minX);
+			__m128 farY = _mm_load_ps(plane.y >= 0.0f ? node.maxY : node.minY);
+			__m128 farZ = _mm_load_ps(plane.z >= 0.0f ? node.maxZ : node.minZ);
+			__m128 nearX = _mm_load_ps(plane.x >= 0.0f ? node.minX : node.maxX);
+			__m128 nearY = _mm_load_ps(plane.y >= 0.0f ? node.minY : node.maxY);
+			__m128 nearZ = _mm_load_ps(plane.z >= 0.0f ? node.minZ : node.maxZ);
+
+			__m128 a = _mm_set1_ps(plane.x), b = _mm_set1_ps(plane.y), c = _mm_set1_ps(plane.z), d = _mm_set1_ps(plane.w);
+			__m128 farDistance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, farX), _mm_mul_ps(b, farY)), _mm_add_ps(_mm_mul_ps(c, farZ), d));
+			__m128 nearDistance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, nearX), _mm_mul_ps(b, nearY)), _mm_add_ps(_mm_mul_ps(c, nearZ), d));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(farDistance, _mm_setzero_ps()));
+			crossing = _mm_or_ps(crossing, _mm_cmplt_ps(nearDistance, _mm_setzero_ps()));
+		}
+
+		int outsideMask = _mm_movemask_ps(outside);
+		int crossingMask = _mm_movemask_ps(crossing);
+		for (int slot = 0; slot < 4; ++slot)
+		{
+			int child = node.children[slot];
+			if ((outsideMask & (1 << slot)) || child == emptySlot)
+			{
+				continue;
+			}
+			if (child < 0)
+			{
+				visible.push_back(~child);
+			}
+			else if (crossingMask & (1 << slot))
+			{
+				stack.push_back(child);
+			}
+			else
+			{
+				addSubtree(child, visible);
+			}
+		}
+	}
+	visibleObjects = (int)visible.size();
+}
+
+int SceneBVH::objectCount() const
+{
+	return (int)objects.size();
+}
+
+int SceneBVH::nodeCount() const
+{
+	return (int)nodes.size();
+}
+
+int SceneBVH::visibleCount() const
+{
+	return visibleObjects;
+}
+
+int SceneBVH::culledCount() const
+{
+	return (int)objects.size() - visibleObjects;
+}
+
+int SceneBVH::testedNodeCount() const
+{
+	return testedNodes;
+}
+
+// top down: halve the range on its longest axis, halve both halves again, and give each quarter a
+// slot. Quarters of one object go straight into the slot, anything bigger gets a node of its own
+int SceneBVH::buildNode(int first, int count, const std::vector<glm::vec3>& centres)
+{
+	int index = (int)nodes.size();
+	nodes.push_back(Node());
+
+	int starts[5];
+	if (count <= 4)
+	{
+		for (int slot = 0; slot < 5; ++slot)
+		{
+			starts[slot] = first + std::min(slot, count);
+		}
+	}
+	else
+	{
+		int middle = first + count / 2;
+		splitRange(buildOrder, first, count, middle, centres);
+		int firstQuarter = first + (middle - first) / 2;
+		int thirdQuarter = middle + (first + count - middle) / 2;
+		splitRange(buildOrder, first, middle - first, firstQuarter, centres);
+		splitRange(buildOrder, middle, first + count - middle, thirdQuarter, centres);
+
+		starts[0] = first;
+		starts[1] = firstQuarter;
+		starts[2] = middle;
+		starts[3] = thirdQuarter;
+		starts[4] = first + count;
+	}
+
+	for (int slot = 0; slot < 4; ++slot)
+	{
+		int slotCount = starts[slot + 1] - starts[slot];
+		int child = emptySlot;
+		if (slotCount == 1)
+		{
+			child = ~buildOrder[starts[slot]];
+		}
+		else if (slotCount > 1)
+		{
+			child = buildNode(starts[slot], slotCount, centres);
+		}
+		nodes[index].children[slot] = child;	// nodes may have grown, no references across buildNode
+	}
+	return index;
+}
+
+// the slot's box from its object, or from the union of its child node's four boxes
+void SceneBVH::setSlot(Node& node, int slot, int child)
+{
+	CullBounds bounds;
+	if (child == emptySlot)
+	{
+		bounds.min = glm::vec3(emptyMin);
+		bounds.max = glm::vec3(emptyMax);
+	}
+	else if (child < 0)
+	{
+		bounds = objects[~child];
+	}
+	else
+	{
+		const Node& childNode = nodes[child];
+		bounds.min = glm::vec3(emptyMin);
+		bounds.max = glm::vec3(emptyMax);
+		for (int i = 0; i < 4; ++i)
+		{
+			bounds.min = glm::min(bounds.min, glm::vec3(childNode.minX[i], childNode.minY[i], childNode.minZ[i]));
+			bounds.max = glm::max(bounds.max, glm::vec3(childNode.maxX[i], childNode.maxY[i], childNode.maxZ[i]));
+		}
+	}
+
+	node.minX[slot] = bounds.min.x;
+	node.minY[slot] = bounds.min.y;
+	node.minZ[slot] = bounds.min.z;
+	node.maxX[slot] = bounds.max.x;
+	node.maxY[slot] = bounds.max.y;
+	node.maxZ[slot] = bounds.max.z;
+}
+
+void SceneBVH::addSubtree(int node, std::vector<int>& visible) const
+{
+	for (int slot = 0; slot < 4; ++slot)
+	{
+		int child = nodes[node].children[slot];
+		if (child == emptySlot)
+		{
+			continue;
+		}
+		if (child < 0)
+		{
+			visible.push_back(~child);
+		}
+		else
+		{
+			addSubtree(child, visible);
+		}
+	}
+}
@@ -0,0 +1,60 @@
+#ifndef SCENEBVH_H
+#define SCENEBVH_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+
+struct CullBounds
+{
+	glm::vec3 min, max;
+};
+
+// Frustum culling over a 4-wide bounding volume hierarchy. Every node keeps the boxes of its four
+// children side by side (min x of all four, then min y, ...) so one SSE test classifies all of them
+// against a plane. A child is either another node or a single object, so objects are culled
+// exactly and never by the box of a group. Subtrees entirely inside the frustum are taken
+// without testing their children.
+// Moving objects only need setBounds() and a refit(), which regrows the boxes bottom up in the
+// same tree; build() again when the objects have moved so far that the tree is a poor fit.
+class SceneBVH
+{
+public:
+	SceneBVH();
+
+	void build(const std::vector<CullBounds>& objects);
+	void setBounds(int object, const CullBounds& bounds);
+	void refit();									// after setBounds(), does nothing if no bounds changed
+
+	// indices of the objects that overlap the frustum of viewProjection, in no particular order
+	void cull(const glm::mat4& viewProjection, std::vector<int>& visible);
+
+	int objectCount() const;
+	int nodeCount() const;
+	int visibleCount() const;		// objects the last cull() returned
+	int culledCount() const;
+	int testedNodeCount() const;	// nodes the last cull() visited, four boxes each
+
+private:
+	static const int emptySlot = -0x7fffffff - 1;	// children: node index, ~object, or emptySlot
+
+	struct alignas(16) Node
+	{
+		float minX[4], minY[4], minZ[4];
+		float maxX[4], maxY[4], maxZ[4];
+		int children[4];
+	};
+
+	std::vector<Node> nodes;		// parents before their children, refit() walks it backwards
+	std::vector<CullBounds> objects;
+	std::vector<int> buildOrder;
+	std::vector<int> stack;			// cull()'s traversal, kept to save the allocation
+	bool dirty;
+	int visibleObjects, testedNodes;
+
+	int buildNode(int first, int count, const std::vector<glm::vec3>& centres);
+	void setSlot(Node& node, int slot, int child);
+	void addSubtree(int node, std::vector<int>& visible) const;	// everything below node, untested
+};
+#endif
@@ -1,156 +1,517 @@
 #include "Shader.h"
+#include "GLCaps.h"
+#include "ProgramCache.h"
+#include "ShaderSource.h"
+
+#include <algorithm>
+
+
+bool Shader::programCacheEnabled = true;
 
 
 //CONSTRUCTOR
 //============
-Shader::Shader(const char* vertexPath, const char* fragmentPath)
+Shader::Shader(const char* vertexPath, const char* fragmentPath, const std::vector<std::string>& defines, ShaderBuild build)
+	: vertexPath(vertexPath), fragmentPath(fragmentPath), defines(defines), vertex(0), fragment(0), cacheHash(0), cached(false), finished(false), linked(false)
 {
 	// Retrive shader source code
 	//===========================
-	std::string vertexCode;		
-	std::string fragmentCode;
-	std::ifstream vShaderFile;
-	std::ifstream fShaderFile;
-
-	vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-	fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-
-	try
+	// with every #include pasted in, see ShaderSource.h
+	ShaderSource vertexSource, fragmentSource;
+	if (!loadShaderSource(vertexPath, vertexSource) || !loadShaderSource(fragmentPath, fragmentSource))
 	{
-		vShaderFile.open(vertexPath);			// open files
-		fShaderFile.open(fragmentPath);
-		std::stringstream vShaderStream, fShaderStream;
+		std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+	}
+	vertexFiles = vertexSource.files;
+	fragmentFiles = fragmentSource.files;
 
-		vShaderStream << vShaderFile.rdbuf();	// read files buffer into streams
-		fShaderStream << fShaderFile.rdbuf();
+	std::string vertexCode = vertexSource.code;
+	std::string fragmentCode = fragmentSource.code;
+	addDefines(vertexCode, defines);
+	addDefines(fragmentCode, defines);
 
-		vShaderFile.close();					// close file handlers
-		fShaderFile.close();
 
-		vertexCode = vShaderStream.str();		// convert stream into string
-		fragmentCode = fShaderStream.str();
-	}
-	catch (std::ifstream::failure e)
+	// Program binary cache, see ProgramCache.h
+	//=========================================
+	if (programCacheEnabled && glCaps.programBinary)
 	{
-		std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+		cachePath = programCachePath(vertexPath, fragmentPath, defines);
+		cacheHash = hashProgramSources(vertexCode, fragmentCode);
+
+		ID = glCreateProgram();
+		if (loadProgramCache(cachePath, cacheHash, ID))
+		{
+			cached = finished = linked = true;
+			reflectUniforms();
+			return;
+		}
+		glDeleteProgram(ID);	// a failed glProgramBinary leaves the program unusable, start again from source
 	}
+
 	const char* vShaderCode = vertexCode.c_str();
 	const char* fShaderCode = fragmentCode.c_str();
 
 
 	// Compile Shaders
 	//================
-	unsigned int vertex, fragment;	// create a variables to hold the shader IDs
-	int success;					// used for error checking
-	char infoLog[512];				// used hold error info logs
-
-	// vertex shader
+	// nothing here waits for the driver, finish() collects the results
 	vertex = glCreateShader(GL_VERTEX_SHADER);				// create vertex shader
 	glShaderSource(vertex, 1, &vShaderCode, NULL);			// attach shader source code to shader object
 	glCompileShader(vertex);								// compile shader
-	
+
+	fragment = glCreateShader(GL_FRAGMENT_SHADER);			// create fragment shader
+	glShaderSource(fragment, 1, &fShaderCode, NULL);
+	glCompileShader(fragment);
+
+	// shader program
+	ID = glCreateProgram();							// create a variable to hold the shader program's ID and create a shader program
+	glAttachShader(ID, vertex);						// attach both shaders to the program
+	glAttachShader(ID, fragment);
+	if (!cachePath.empty())
+	{
+		glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+	glLinkProgram(ID);								// link attached shaders to the program
+
+	if (build == SHADER_BUILD_NOW)
+	{
+		finish();
+	}
+}
+
+
+
+// FUNCTIONS
+//==========
+// activate/deactivate program
+void Shader::use()
+{
+	glUseProgram(ID);
+}
+void Shader::stopUsing()
+{
+	glDeleteProgram(ID);
+}
+
+void Shader::setProgramCache(bool enabled)
+{
+	programCacheEnabled = enabled;
+}
+
+bool Shader::loadedFromCache() const
+{
+	return cached;
+}
+
+// without parallel compile support there is no way to ask, finish() may block
+bool Shader::isReady() const
+{
+	if (finished || !glCaps.parallelShaderCompile)
+	{
+		return true;
+	}
+	int complete = 0;
+	glGetProgramiv(ID, GL_COMPLETION_STATUS_KHR, &complete);
+	return complete != 0;
+}
+
+bool Shader::isFinished() const
+{
+	return finished;
+}
+
+bool Shader::isLinked() const
+{
+	return linked;
+}
+
+bool Shader::reload()
+{
+	Shader rebuilt(vertexPath.c_str(), fragmentPath.c_str(), defines);
+	if (!rebuilt.linked)
+	{
+		glDeleteProgram(rebuilt.ID);
+		return false;
+	}
+
+	// an asynchronous build that never finished still owns its stages
+	if (!finished)
+	{
+		glDeleteShader(vertex);
+		glDeleteShader(fragment);
+	}
+	glDeleteProgram(ID);
+
+	std::vector<UniformEntry> previousTable;
+	previousTable.swap(uniformTable);
+	std::size_t previousSlots = uniformLocations.size();
+	*this = rebuilt;
+	keepUniformSlots(previousTable, previousSlots);
+	return true;
+}
+
+bool Shader::readsFile(const std::string& path) const
+{
+	return std::find(vertexFiles.begin(), vertexFiles.end(), path) != vertexFiles.end() ||
+		std::find(fragmentFiles.begin(), fragmentFiles.end(), path) != fragmentFiles.end();
+}
+
+std::vector<std::string> Shader::sourceFiles() const
+{
+	std::vector<std::string> files = vertexFiles;
+	for (std::size_t i = 0; i < fragmentFiles.size(); ++i)
+	{
+		if (std::find(files.begin(), files.end(), fragmentFiles[i]) == files.end())
+		{
+			files.push_back(fragmentFiles[i]);
+		}
+	}
+	return files;
+}
+
+// the first status query is where the driver makes us wait for the compile and link
+void Shader::finish()
+{
+	if (finished)
+	{
+		return;
+	}
+	finished = true;
+
+	int success;					// used for error checking
+	char infoLog[512];				// used hold error info logs
+
 	glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);		// check if the shader has compiled succesfully and print a message if not
 	if (!success)
 	{
 		glGetShaderInfoLog(vertex, 512, NULL, infoLog);
-		std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
+		std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << describeSourceStrings(vertexFiles) << std::endl;
 	}
 
-	// fragment shader
-	fragment = glCreateShader(GL_FRAGMENT_SHADER);			// create fragment shader
-	glShaderSource(fragment, 1, &fShaderCode, NULL);		// attach shader source code to shader object
-	glCompileShader(fragment);								// compile shader
-
 	glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);	// check for compilation errors
 	if (!success)
 	{
 		glGetShaderInfoLog(fragment, 512, NULL, infoLog);
-		std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
+		std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << describeSourceStrings(fragmentFiles) << std::endl;
 	}
 
-	// shader program
-	ID = glCreateProgram();							// create a variable to hold the shader program's ID and create a shader program
-	glAttachShader(ID, vertex);						// attach both shaders to the program
-	glAttachShader(ID, fragment);
-
-	glLinkProgram(ID);								// link attached shaders to the program
 	glGetProgramiv(ID, GL_LINK_STATUS, &success);	// check for linking errors
 	if (!success)
 	{
 		glGetProgramInfoLog(ID, 512, NULL, infoLog);
 		std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
 	}
+	else
+	{
+		linked = true;
+		if (!cachePath.empty() && !saveProgramCache(cachePath, cacheHash, ID, vertexPath, fragmentPath))
+		{
+			std::cout << "Failed to write program cache: " << cachePath << std::endl;
+		}
+	}
 
 	glDeleteShader(vertex);		// delete shader objects
 	glDeleteShader(fragment);
-}
-
+	vertex = fragment = 0;
 
+	reflectUniforms();			// cache every uniform location so nothing is looked up while rendering
+}
 
-// FUNCTIONS
-//==========
-// activate/deactivate program
-void Shader::use()
+// #version has to stay the first line, so the defines go in after it, then a #line puts the line numbers back
+void Shader::addDefines(std::string& code, const std::vector<std::string>& defines)
 {
-	glUseProgram(ID);
+	if (defines.empty())
+	{
+		return;
+	}
+
+	std::string lines;
+	for (std::size_t i = 0; i < defines.size(); ++i)
+	{
+		lines += "#define " + defines[i] + "\n";
+	}
+	std::size_t version = code.find("#version");
+	std::size_t lineEnd = version == std::string::npos ? std::string::npos : code.find('\n', version);
+	if (lineEnd == std::string::npos)
+	{
+		code = lines + "#line 1 0\n" + code;
+	}
+	else
+	{
+		int nextLine = (int)std::count(code.begin(), code.begin() + lineEnd, '\n') + 2;
+		code.insert(lineEnd + 1, lines + "#line " + std::to_string(nextLine) + " 0\n");
+	}
 }
-void Shader::stopUsing()
+
+// programs that declare the same block can all read one buffer bound at this binding
+void Shader::bindUniformBlock(const std::string& blockName, unsigned int binding) const
 {
-	glDeleteProgram(ID);
+	unsigned int blockIndex = glGetUniformBlockIndex(ID, blockName.c_str());
+	if (blockIndex != GL_INVALID_INDEX)
+	{
+		glUniformBlockBinding(ID, blockIndex, binding);
+	}
 }
 
-// find uniform location and set its value
+// find uniform location and set its value (from the table built at link time, not the driver)
 void Shader::setBool(const std::string& name, bool value) const
 {
-	glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+	glUniform1i(getUniformLocation(name), (int)value);
 }
 void Shader::setInt(const std::string& name, int value) const
 {
-	glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+	glUniform1i(getUniformLocation(name), value);
 }
 void Shader::setFloat(const std::string& name, float value) const
 {
-	glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+	glUniform1f(getUniformLocation(name), value);
 }
 
 void Shader::setVec2(const std::string& name, const glm::vec2& value) const
 {
-	glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+	glUniform2fv(getUniformLocation(name), 1, &value[0]);
 }
 void Shader::setVec2(const std::string& name, float x, float y) const
 {
-	glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+	glUniform2f(getUniformLocation(name), x, y);
 }
 // ------------------------------------------------------------------------
 void Shader::setVec3(const std::string& name, const glm::vec3& value) const
 {
-	glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+	glUniform3fv(getUniformLocation(name), 1, &value[0]);
 }
 void Shader::setVec3(const std::string& name, float x, float y, float z) const
 {
-	glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+	glUniform3f(getUniformLocation(name), x, y, z);
 }
 // ------------------------------------------------------------------------
 void Shader::setVec4(const std::string& name, const glm::vec4& value) const
 {
-	glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+	glUniform4fv(getUniformLocation(name), 1, &value[0]);
 }
 void Shader::setVec4(const std::string& name, float x, float y, float z, float w)
 {
-	glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+	glUniform4f(getUniformLocation(name), x, y, z, w);
 }
 
 void Shader::setMat2(const std::string& name, const glm::mat2& mat) const
 {
-	glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+	glUniformMatrix2fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
 }
 // ------------------------------------------------------------------------
 void Shader::setMat3(const std::string& name, const glm::mat3& mat) const
 {
-	glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+	glUniformMatrix3fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
 }
 
 void Shader::setMat4(const std::string& name, const glm::mat4 &mat) const
 {
-	glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+	glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
+}
+
+
+// UNIFORM TABLE
+//==============
+// FNV-1a, only ever used on uniform names
+static unsigned int hashUniformName(const std::string& name)
+{
+	unsigned int hash = 2166136261u;
+	for (std::size_t i = 0; i < name.size(); ++i)
+	{
+		hash ^= (unsigned char)name[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+// query every active uniform once, arrays are expanded so "lightPos[2]" gets its own entry
+// and the bare array name "lightPos" resolves to element 0 like glGetUniformLocation does.
+// GL reports every array as "name[0]", whatever its size or how many elements survived optimisation
+void Shader::reflectUniforms()
+{
+	uniformLocations.assign(1, -1);		// slot 0 is the inactive location handed out for unknown names
+	uniformTable.clear();
+
+	int uniformCount = 0, maxNameLength = 0;
+	glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &uniformCount);
+	glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+	std::vector<std::string> names;
+	std::vector<int> sizes;
+	std::vector<bool> arrays;
+	std::vector<char> nameBuffer(maxNameLength + 1);
+	for (int i = 0; i < uniformCount; ++i)
+	{
+		int size = 0, length = 0;
+		GLenum type;
+		glGetActiveUniform(ID, i, (GLsizei)nameBuffer.size(), &length, &size, &type, &nameBuffer[0]);
+
+		std::string name(&nameBuffer[0], length);
+		bool array = name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0;
+		if (array)
+		{
+			name.resize(name.size() - 3);
+		}
+		names.push_back(name);
+		sizes.push_back(size);
+		arrays.push_back(array);
+	}
+
+	// size the table to at most half full so probes stay short
+	std::size_t entryCount = 0;
+	for (std::size_t i = 0; i < sizes.size(); ++i)
+	{
+		entryCount += arrays[i] ? sizes[i] + 1 : 1;
+	}
+	std::size_t tableSize = 16;
+	while (tableSize < entryCount * 2)
+	{
+		tableSize *= 2;
+	}
+	UniformEntry empty = { 0, 0, std::string() };
+	uniformTable.assign(tableSize, empty);
+
+	for (std::size_t i = 0; i < names.size(); ++i)
+	{
+		int location = glGetUniformLocation(ID, names[i].c_str());
+		if (location == -1)
+		{
+			continue;	// members of uniform blocks have no location
+		}
+
+		if (!arrays[i])
+		{
+			addUniform(names[i], location);
+			continue;
+		}
+
+		addUniform(names[i], location);
+		for (int element = 0; element < sizes[i]; ++element)
+		{
+			std::string elementName = names[i] + "[" + std::to_string(element) + "]";
+			addUniform(elementName, glGetUniformLocation(ID, elementName.c_str()));
+		}
+	}
+}
+
+void Shader::addUniform(const std::string& name, int location)
+{
+	std::size_t mask = uniformTable.size() - 1;
+	unsigned int hash = hashUniformName(name);
+	std::size_t bucket = hash & mask;
+	while (uniformTable[bucket].slot != 0)
+	{
+		bucket = (bucket + 1) & mask;
+	}
+
+	uniformTable[bucket].hash = hash;
+	uniformTable[bucket].slot = (int)uniformLocations.size();
+	uniformTable[bucket].name = name;
+	uniformLocations.push_back(location);
+}
+
+// after reload(): the old program's names keep their slots, pointing at the new program's locations
+// (or -1 where a uniform went away), and anything the new program added goes after them
+void Shader::keepUniformSlots(const std::vector<UniformEntry>& previousTable, std::size_t previousSlots)
+{
+	std::vector<std::string> names(std::max<std::size_t>(previousSlots, 1));	// slot 0 stays the inactive one
+	for (std::size_t i = 0; i < previousTable.size(); ++i)
+	{
+		if (previousTable[i].slot != 0)
+		{
+			names[previousTable[i].slot] = previousTable[i].name;
+		}
+	}
+	for (std::size_t i = 0; i < uniformTable.size(); ++i)
+	{
+		if (uniformTable[i].slot != 0 && std::find(names.begin() + 1, names.end(), uniformTable[i].name) == names.end())
+		{
+			names.push_back(uniformTable[i].name);
+		}
+	}
+	std::vector<int> locations(names.size(), -1);
+	for (std::size_t slot = 1; slot < names.size(); ++slot)
+	{
+		locations[slot] = getUniformLocation(names[slot]);
+	}
+
+	std::size_t tableSize = 16;
+	while (tableSize < names.size() * 2)
+	{
+		tableSize *= 2;
+	}
+	UniformEntry empty = { 0, 0, std::string() };
+	uniformTable.assign(tableSize, empty);
+	uniformLocations.assign(1, -1);
+	for (std::size_t slot = 1; slot < names.size(); ++slot)
+	{
+		addUniform(names[slot], locations[slot]);
+	}
+}
+
+int Shader::findSlot(const std::string& name) const
+{
+	if (uniformTable.empty())
+	{
+		return 0;
+	}
+
+	std::size_t mask = uniformTable.size() - 1;
+	unsigned int hash = hashUniformName(name);
+	for (std::size_t bucket = hash & mask; uniformTable[bucket].slot != 0; bucket = (bucket + 1) & mask)
+	{
+		if (uniformTable[bucket].hash == hash && uniformTable[bucket].name == name)
+		{
+			return uniformTable[bucket].slot;
+		}
+	}
+	return 0;
+}
+
+int Shader::getUniformLocation(const std::string& name) const
+{
+	return uniformLocations.empty() ? -1 : uniformLocations[findSlot(name)];
+}
+
+
+
+// HANDLE SETTERS
+//===============
+void Shader::set(UniformHandle<bool> handle, bool value) const
+{
+	glUniform1i(uniformLocations[handle.slot], (int)value);
+}
+void Shader::set(UniformHandle<int> handle, int value) const
+{
+	glUniform1i(uniformLocations[handle.slot], value);
+}
+void Shader::set(UniformHandle<float> handle, float value) const
+{
+	glUniform1f(uniformLocations[handle.slot], value);
+}
+// ------------------------------------------------------------------------
+void Shader::set(UniformHandle<glm::vec2> handle, const glm::vec2& value) const
+{
+	glUniform2fv(uniformLocations[handle.slot], 1, &value[0]);
+}
+void Shader::set(UniformHandle<glm::vec3> handle, const glm::vec3& value) const
+{
+	glUniform3fv(uniformLocations[handle.slot], 1, &value[0]);
+}
+void Shader::set(UniformHandle<glm::vec4> handle, const glm::vec4& value) const
+{
+	glUniform4fv(uniformLocations[handle.slot], 1, &value[0]);
+}
+// ------------------------------------------------------------------------
+void Shader::set(UniformHandle<glm::mat2> handle, const glm::mat2& mat) const
+{
+	glUniformMatrix2fv(uniformLocations[handle.slot], 1, GL_FALSE, &mat[0][0]);
+}
+void Shader::set(UniformHandle<glm::mat3> handle, const glm::mat3& mat) const
+{
+	glUniformMatrix3fv(uniformLocations[handle.slot], 1, GL_FALSE, &mat[0][0]);
+}
+void Shader::set(UniformHandle<glm::mat4> handle, const glm::mat4& mat) const
+{
+	glUniformMatrix4fv(uniformLocations[handle.slot], 1, GL_FALSE, &mat[0][0]);
 }
\ No newline at end of file
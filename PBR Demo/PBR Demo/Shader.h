@@ -4,22 +4,61 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <cstdint>
 #include <string>
+#include <vector>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 
 
+// a uniform resolved once up front. setting through a handle is one array index and one glUniform call
+template<typename T>
+struct UniformHandle
+{
+	int slot = 0;	// index into the owning Shader's location table, slot 0 is always the inactive location -1
+};
+
+
+// SHADER_BUILD_ASYNC only submits the compile and link, the program can't be used until finish().
+// Where the driver has KHR_parallel_shader_compile they run on its own threads and isReady() says
+// when finish() would no longer wait
+enum ShaderBuild
+{
+	SHADER_BUILD_NOW,
+	SHADER_BUILD_ASYNC
+};
+
+
 class Shader
 {
 public:
 	unsigned int ID;	// program ID
 
-	Shader(const char* vertexPath, const char* fragmentPath);	// constructor for reading/building shaders
+	// constructor for reading/building shaders. each define is added to both stages as #define NAME, straight after #version
+	Shader(const char* vertexPath, const char* fragmentPath, const std::vector<std::string>& defines = std::vector<std::string>(),
+		ShaderBuild build = SHADER_BUILD_NOW);
 
 	void use();													//activate shader
 	void stopUsing();
 
+	static void setProgramCache(bool enabled);	// on by default, used wherever glCaps.programBinary is set
+	bool loadedFromCache() const;				// linked from a saved program binary rather than compiled
+
+	bool isReady() const;		// polls, never waits
+	void finish();				// waits for the build, reports errors and looks up the uniforms. does nothing the second time
+	bool isFinished() const;
+	bool isLinked() const;		// once finished, false if compiling or linking failed
+
+	// for hot reloading: build again from the same files and defines. a build that fails leaves the old
+	// program in place, still usable. the program's ID changes, so anything holding it needs the new one.
+	// UniformHandles taken before stay valid, their names are looked up again in the new program
+	bool reload();
+	bool readsFile(const std::string& path) const;	// either stage's source, or anything they #include
+	std::vector<std::string> sourceFiles() const;	// every file both stages were built from
+
+	void bindUniformBlock(const std::string& blockName, unsigned int binding) const;	// attach a uniform block to a buffer binding point
+
 	void setBool(const std::string &name, bool value) const;	// query uniform location
 	void setInt(const std::string &name, int value) const;		// and set value
 	void setFloat(const std::string &name, float value) const;
@@ -36,5 +75,51 @@ public:
 	void setMat2(const std::string& name, const glm::mat2& mat) const;
 	void setMat3(const std::string& name, const glm::mat3& mat) const;
 	void setMat4(const std::string& name, const glm::mat4& mat) const;
+
+	// handles for uniforms looked up in the table built at link time. names that aren't active give
+	// a handle that sets nothing, the same as location -1 does
+	template<typename T>
+	UniformHandle<T> getUniform(const std::string& name) const
+	{
+		UniformHandle<T> handle;
+		handle.slot = findSlot(name);
+		return handle;
+	}
+	int getUniformLocation(const std::string& name) const;
+
+	void set(UniformHandle<bool> handle, bool value) const;
+	void set(UniformHandle<int> handle, int value) const;
+	void set(UniformHandle<float> handle, float value) const;
+	void set(UniformHandle<glm::vec2> handle, const glm::vec2& value) const;
+	void set(UniformHandle<glm::vec3> handle, const glm::vec3& value) const;
+	void set(UniformHandle<glm::vec4> handle, const glm::vec4& value) const;
+	void set(UniformHandle<glm::mat2> handle, const glm::mat2& mat) const;
+	void set(UniformHandle<glm::mat3> handle, const glm::mat3& mat) const;
+	void set(UniformHandle<glm::mat4> handle, const glm::mat4& mat) const;
+
+private:
+	// every active uniform, array elements included, reflected once after linking
+	struct UniformEntry
+	{
+		unsigned int hash;
+		int slot;		// 0 marks an empty bucket
+		std::string name;
+	};
+	std::vector<int> uniformLocations;		// slot -> location
+	std::vector<UniformEntry> uniformTable;	// open addressing, power of two size
+	std::string vertexPath, fragmentPath;
+	std::vector<std::string> defines;
+	std::vector<std::string> vertexFiles, fragmentFiles;	// the paths and what they include, by source string number
+	unsigned int vertex, fragment;			// until finish()
+	std::string cachePath;					// empty when the program cache isn't used
+	std::uint64_t cacheHash;
+	bool cached, finished, linked;
+	static bool programCacheEnabled;
+
+	static void addDefines(std::string& code, const std::vector<std::string>& defines);
+	void reflectUniforms();
+	void addUniform(const std::string& name, int location);
+	void keepUniformSlots(const std::vector<UniformEntry>& previousTable, std::size_t previousSlots);
+	int findSlot(const std::string& name) const;
 };
 #endif
\ No newline at end of file
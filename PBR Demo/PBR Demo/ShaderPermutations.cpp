@@ -0,0 +1,120 @@
+#include "ShaderPermutations.h"
+#include "Hash.h"
+#include "ShaderSource.h"
+
+#include <algorithm>
+#include <cctype>
+
+
+// whole word matches only, so a keyword isn't found inside a longer name
+static bool mentions(const std::string& source, const std::string& keyword)
+{
+	for (std::size_t at = source.find(keyword); at != std::string::npos; at = source.find(keyword, at + 1))
+	{
+		bool startsWord = at == 0 || !(isalnum((unsigned char)source[at - 1]) || source[at - 1] == '_');
+		std::size_t end = at + keyword.size();
+		bool endsWord = end == source.size() || !(isalnum((unsigned char)source[end]) || source[end] == '_');
+		if (startsWord && endsWord)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+
+//CONSTRUCTOR
+//============
+ShaderPermutations::ShaderPermutations(const char* vertexPath, const char* fragmentPath, const std::vector<std::string>& keywords)
+	: vertexPath(vertexPath), fragmentPath(fragmentPath), keywords(keywords), used(0)
+{
+	findKeywords();
+}
+
+
+
+// FUNCTIONS
+//==========
+Shader& ShaderPermutations::variant(std::uint32_t features, ShaderBuild build)
+{
+	std::unique_ptr<Shader>& shader = variants[variantKey(features)];
+	if (!shader)
+	{
+		std::vector<std::string> defines;
+		for (std::size_t i = 0; i < keywords.size() && i < 32; ++i)
+		{
+			if (features & used & (1u << i))
+			{
+				defines.push_back(keywords[i]);
+			}
+		}
+		shader.reset(new Shader(vertexPath.c_str(), fragmentPath.c_str(), defines, build));
+	}
+	return *shader;
+}
+
+bool ShaderPermutations::hasVariant(std::uint32_t features) const
+{
+	return variants.count(variantKey(features)) != 0;
+}
+
+// variants keep their keys: a keyword the sources only start or stop mentioning now gets a new variant next time it is asked for
+int ShaderPermutations::reload(const std::string& path)
+{
+	if (std::find(files.begin(), files.end(), path) == files.end())
+	{
+		return 0;
+	}
+
+	findKeywords();
+	int rebuilt = 0;
+	for (std::unordered_map<std::uint64_t, std::unique_ptr<Shader> >::iterator i = variants.begin(); i != variants.end(); ++i)
+	{
+		rebuilt += i->second->reload() ? 1 : 0;
+	}
+	return rebuilt;
+}
+
+std::uint32_t ShaderPermutations::usedFeatures() const
+{
+	return used;
+}
+
+int ShaderPermutations::variantCount() const
+{
+	return (int)variants.size();
+}
+
+// hash of the defines the variant is built with, in keyword order
+std::uint64_t ShaderPermutations::variantKey(std::uint32_t features) const
+{
+	std::uint64_t hash = hashBytes("", 0);
+	for (std::size_t i = 0; i < keywords.size() && i < 32; ++i)
+	{
+		if (features & used & (1u << i))
+		{
+			hash = hashBytes(keywords[i].c_str(), keywords[i].size() + 1, hash);
+		}
+	}
+	return hash;
+}
+
+// includes are searched too, along with the files they came from
+void ShaderPermutations::findKeywords()
+{
+	ShaderSource vertexSource, fragmentSource;
+	loadShaderSource(vertexPath, vertexSource);
+	loadShaderSource(fragmentPath, fragmentSource);
+	files = vertexSource.files;
+	files.insert(files.end(), fragmentSource.files.begin(), fragmentSource.files.end());
+
+	used = 0;
+	std::string sources = vertexSource.code + "\n" + fragmentSource.code;
+	for (std::size_t i = 0; i < keywords.size() && i < 32; ++i)
+	{
+		if (mentions(sources, keywords[i]))
+		{
+			used |= 1u << i;
+		}
+	}
+}
@@ -0,0 +1,46 @@
+#ifndef SHADERPERMUTATIONS_H
+#define SHADERPERMUTATIONS_H
+
+#include <Shader.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+// One vertex and fragment shader pair built as any number of programs, each with its own set of feature
+// keywords defined. A variant is asked for by bitset, bit i standing for keywords[i], and only built the
+// first time it is asked for. Features a variant leaves out are compiled out by the preprocessor rather
+// than branched over, so the cheap variants don't pay for the expensive ones.
+// Keywords neither source mentions are dropped from a set before it is looked up, and variants are kept
+// by the hash of the defines that are left: sets that only differ in unused keywords share one program.
+class ShaderPermutations
+{
+public:
+	ShaderPermutations(const char* vertexPath, const char* fragmentPath, const std::vector<std::string>& keywords);
+
+	// the program for these features, built now or submitted with build on first use. ASYNC variants
+	// have to be finished before they are drawn with, see Shader::finish()
+	Shader& variant(std::uint32_t features, ShaderBuild build = SHADER_BUILD_NOW);
+	bool hasVariant(std::uint32_t features) const;
+
+	// hot reload: when path is one of the sources or anything they include, rebuild every variant built so far (see Shader::reload())
+	// and look for the keywords again. returns how many variants were rebuilt, none if path isn't a source
+	int reload(const std::string& path);
+
+	std::uint32_t usedFeatures() const;		// keywords the sources mention
+	int variantCount() const;
+
+private:
+	std::string vertexPath, fragmentPath;
+	std::vector<std::string> keywords;
+	std::uint32_t used;
+	std::vector<std::string> files;		// both sources and everything they include
+	std::unordered_map<std::uint64_t, std::unique_ptr<Shader> > variants;
+
+	std::uint64_t variantKey(std::uint32_t features) const;
+	void findKeywords();
+};
+#endif
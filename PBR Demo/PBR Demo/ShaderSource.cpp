@@ -0,0 +1,159 @@
+#include "ShaderSource.h"
+#include "Hash.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unordered_map>
+
+
+// path -> hash of its text -> the text, identical files share one copy
+static std::unordered_map<std::string, std::uint64_t> cachedFiles;
+static std::unordered_map<std::uint64_t, std::string> cachedTexts;
+
+static const std::string* readCached(const std::string& path)
+{
+	std::unordered_map<std::string, std::uint64_t>::const_iterator file = cachedFiles.find(path);
+	if (file == cachedFiles.end())
+	{
+		std::ifstream stream(path.c_str(), std::ios::binary);
+		if (!stream)
+		{
+			return NULL;
+		}
+		std::stringstream text;
+		text << stream.rdbuf();
+
+		std::string contents = text.str();
+		std::uint64_t hash = hashBytes(contents.data(), contents.size());
+		cachedTexts.insert(std::make_pair(hash, contents));
+		file = cachedFiles.insert(std::make_pair(path, hash)).first;
+	}
+	return &cachedTexts[file->second];
+}
+
+static std::string directoryOf(const std::string& path)
+{
+	std::size_t slash = path.find_last_of("/\\");
+	return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+}
+
+// the quoted name if line is an #include directive, spaces allowed around the #
+static bool parseInclude(const std::string& line, std::string& name)
+{
+	std::size_t at = line.find_first_not_of(" \t");
+	if (at == std::string::npos || line[at] != '#')
+	{
+		return false;
+	}
+	at = line.find_first_not_of(" \t", at + 1);
+	if (at == std::string::npos || line.compare(at, 7, "include") != 0)
+	{
+		return false;
+	}
+
+	std::size_t open = line.find('"', at + 7);
+	std::size_t close = open == std::string::npos ? std::string::npos : line.find('"', open + 1);
+	if (close == std::string::npos)
+	{
+		return false;
+	}
+	name = line.substr(open + 1, close - open - 1);
+	return true;
+}
+
+// including is the chain of files being expanded, outermost first
+static bool expand(const std::string& path, int sourceString, ShaderSource& source, std::vector<std::string>& including)
+{
+	const std::string* text = readCached(path);
+	if (!text)
+	{
+		return false;
+	}
+
+	including.push_back(path);
+	bool complete = true;
+	std::istringstream lines(*text);
+	std::string line, name;
+	for (int lineNumber = 1; std::getline(lines, line); ++lineNumber)
+	{
+		if (!parseInclude(line, name))
+		{
+			source.code += line;
+			source.code += '\n';
+			continue;
+		}
+
+		std::string includePath = directoryOf(path) + name;
+		if (std::find(including.begin(), including.end(), includePath) != including.end())
+		{
+			source.code += '\n';	// recursive, the line is left blank
+			continue;
+		}
+
+		int includeString = (int)(std::find(source.files.begin(), source.files.end(), includePath) - source.files.begin());
+		if (includeString == (int)source.files.size())
+		{
+			source.files.push_back(includePath);
+		}
+		source.code += "#line 1 " + std::to_string(includeString) + "\n";
+		if (!expand(includePath, includeString, source, including))
+		{
+			std::cout << "ERROR::SHADER::INCLUDE_NOT_FOUND: " << name << " in " << path << std::endl;
+			complete = false;
+		}
+		source.code += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(sourceString) + "\n";
+	}
+	including.pop_back();
+	return complete;
+}
+
+
+
+// FUNCTIONS
+//==========
+bool loadShaderSource(const std::string& path, ShaderSource& source)
+{
+	source.code.clear();
+	source.files.assign(1, path);
+	std::vector<std::string> including;
+	return expand(path, 0, source, including);
+}
+
+void forgetShaderFile(const std::string& path)
+{
+	std::unordered_map<std::string, std::uint64_t>::iterator file = cachedFiles.find(path);
+	if (file == cachedFiles.end())
+	{
+		return;
+	}
+	std::uint64_t hash = file->second;
+	cachedFiles.erase(file);
+
+	// the text goes too once no other path shares it, so edits don't pile up old versions
+	for (file = cachedFiles.begin(); file != cachedFiles.end(); ++file)
+	{
+		if (file->second == hash)
+		{
+			return;
+		}
+	}
+	cachedTexts.erase(hash);
+}
+
+std::string describeSourceStrings(const std::vector<std::string>& files)
+{
+	if (files.size() < 2)
+	{
+		return std::string();
+	}
+
+	std::string description = "source strings:";
+	for (std::size_t i = 0; i < files.size(); ++i)
+	{
+		description += (i == 0 ? " " : ", ") + std::to_string(i) + " " + files[i].substr(files[i].find_last_of("/\\") + 1);
+	}
+	return description;
+}
@@ -0,0 +1,37 @@
+#ifndef SHADERSOURCE_H
+#define SHADERSOURCE_H
+
+#include <string>
+#include <vector>
+
+
+// GLSL #INCLUDE
+//==============
+// A line #include "file" is replaced by that file's text, found relative to the including file, and
+// included files may include others. Includes are expanded before the GLSL preprocessor runs, so a file is
+// pasted in every time it is included, even inside an #ifdef that compiles out; shared headers carry their
+// own #ifndef guards to keep their declarations to one copy. A file that includes itself, directly or
+// through others, is left out at that point instead of expanding forever - its guard would skip it anyway.
+// #line directives keep compiler messages pointing at the right file and line, the file being the source
+// string number: 0 for the stage's own file, then one per included file in the order they were first included.
+// A file pasted in again keeps its number.
+// Files are read through a process wide cache, so a header every program includes is only read from disk
+// once. The cache keeps each distinct text once, keyed by its hash, with the paths pointing into it.
+
+struct ShaderSource
+{
+	std::string code;					// every include expanded
+	std::vector<std::string> files;		// files[n] is source string n in compiler messages
+};
+
+// false if the file, or anything it includes, could not be read. what could be read is still in source
+bool loadShaderSource(const std::string& path, ShaderSource& source);
+
+// drop a file from the cache, and its text unless another file has the same contents. the next load reads
+// it from disk again. for files that changed on disk
+void forgetShaderFile(const std::string& path);
+
+// "source strings: 0 vs_PBR.glsl, 1 inc_FrameData.glsl", to read compiler messages by. empty for a single file
+std::string describeSourceStrings(const std::vector<std::string>& files);
+
+#endif
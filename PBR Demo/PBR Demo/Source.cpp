@@ -7,9 +7,35 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include <Shader.h>
+#include <ShaderPermutations.h>
 #include <Camera.h>
+#include <GLCaps.h>
+#include <TextureStreamer.h>
+#include <RingBuffer.h>
+#include <FrameUniforms.h>
+#include <Primitives.h>
+#include <MaterialLibrary.h>
+#include <IBL.h>
+#include <Headless.h>
+#include <Profiler.h>
+#include <MappedFile.h>
+#include <TextureCompression.h>
+#include <LightClusters.h>
+#include <GBuffer.h>
+#include <SceneBVH.h>
+#include <RenderQueue.h>
+#include <AssetWatcher.h>
+#include <ShaderSource.h>
 
 #include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <unordered_map>
+#include <random>
 
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);	// acount for resizing the window
@@ -17,15 +43,79 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void processInput(GLFWwindow* window);	// for processing all inputs
 unsigned int loadTexture(const char* path);
-void loadTextureSet(std::string setName, int i);
-void renderSphere();
-void renderCube();
+void loadTextureSet(TextureStreamer& streamer, MaterialLibrary& materials, std::string setName, int i);
+bool compressedTextureSetAvailable(const std::string& setName, int layerSize);
+bool loadCompressedTextureSet(MaterialLibrary& materials, const std::string& setName, int i);
+bool loadCompressedMap(MaterialLibrary& materials, const std::string& setName, int i, MaterialMap map);
+std::string textureMapPath(const std::string& setName, const std::string& mapName, const std::string& extension = ".png");
+std::string shaderPath(const std::string& name);
+void benchmarkTextureLoading();
+std::vector<SphereInstance> layoutSpheres(int count, float spacing, int materialCount);
+std::vector<CullBounds> sphereBounds(const std::vector<SphereInstance>& instances);
+void sortFrontToBack(std::vector<SphereInstance>& instances, const glm::vec3& eye);
+std::vector<PointLight> sceneLights(int extraCount, const std::vector<SphereInstance>& spheres);
+std::vector<PointLight> scatterLights(int count, const std::vector<SphereInstance>& spheres);
+void bindLighting(const IBLMaps& ibl, const LightClusters& lightClusters);
+void finishProgram(Shader& shader);
+
+// --bench-deferred: forward against deferred shading as spheres and lights are added
+struct ShadingBenchmarkCase
+{
+	int spheres;
+	int lights;			// on top of the main light
+	bool deferred;
+	double totalMs;		// frames after the warm up, submit to GPU finished
+	int frames;
+};
+std::vector<ShadingBenchmarkCase> shadingBenchmarkCases();
+void printShadingBenchmark(const std::vector<ShadingBenchmarkCase>& cases);
+
+// feature keywords of the sphere programs, bit i is sphereShaderKeywords()[i]. see ShaderPermutations.h
+enum SphereFeature
+{
+	SPHERE_BINDLESS_TEXTURES = 1 << 0,	// material arrays through resident handles
+	SPHERE_GBUFFER = 1 << 1,			// deferred geometry pass, writes the surface instead of lighting it
+	SPHERE_DEPTH_ONLY = 1 << 2,			// depth pre-pass
+	SPHERE_DERIVATIVE_TANGENTS = 1 << 3	// normal map tangent frame from screen space derivatives instead of the mesh's tangents
+};
+std::vector<std::string> sphereShaderKeywords();
+
+// the frame's passes, in the order the render queue runs them
+enum FramePass
+{
+	PASS_DEPTH,			// --depth-prepass only
+	PASS_OPAQUE,		// spheres, shaded or into the G-buffer
+	PASS_LIGHT_SPHERE,	// the same for the main light's sphere, timed on its own
+	PASS_LIGHTING,		// deferred only
+	PASS_SKY
+};
 
 // SETTINGS
 //=========
 const unsigned int scr_width = 1600;
 const unsigned int scr_height = 900;
 
+int sphereCount = 5;				// --spheres N, laid out in a square grid once there are more than a row's worth
+bool instancedRendering = true;		// --per-draw issues one draw per sphere instead of one for all of them
+IBLSettings iblSettings;			// --ibl-samples N overrides every precompute pass's sample count
+bool headless = false;				// --headless renders a fixed camera path offscreen, see Headless.h
+HeadlessSettings headlessSettings;
+bool printProfile = false;			// --profile prints min/avg/p99 per pass every couple of seconds
+std::string traceFile;				// --trace FILE writes a Chrome trace of the run on exit
+int extraLightCount = 0;			// --lights N scatters N small coloured point lights around the spheres
+bool deferredShading = false;		// --deferred writes a G-buffer and lights it in one full screen pass instead of shading while drawing
+bool benchmarkDeferred = false;		// --bench-deferred times both paths over a range of sphere and light counts, headless
+bool depthPrePass = false;			// --depth-prepass lays down depth with a position only program first, shading then only runs for visible fragments
+bool frustumCulling = true;			// --no-culling submits every sphere, on screen or not
+bool sphereLods = true;				// --no-lod draws every sphere with the full 64 segment mesh
+bool multiDrawIndirect = true;		// --no-indirect issues one instanced draw per LOD instead of one indirect draw for all of them
+bool frontToBack = true;			// --unsorted draws the spheres in array order instead of nearest first
+bool bindlessTextures = true;		// --no-bindless binds the material arrays to texture units instead of making them resident
+bool programCache = true;			// --no-program-cache compiles every shader from source instead of loading saved program binaries
+bool decodeTextures = false;		// --decode-textures decodes the BC7/BC5 DDS files on the CPU even if the driver can sample them
+bool derivativeTangents = false;	// --derivative-tangents builds the normal map's tangent frame per fragment instead of reading the mesh's per-vertex tangents
+bool hotReload = true;				// --no-hot-reload stops watching the shaders, material maps and HDR for changes. headless runs never watch
+
 // CAMERA
 //=======
 Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
@@ -40,39 +130,195 @@ float lastFrame = 0.0f;
 
 // TEXTURES
 //=========
-unsigned int albedo_0, albedo_1, albedo_2, albedo_3, albedo_4;
-unsigned int normal_0, normal_1, normal_2, normal_3, normal_4;
-unsigned int metallic_0, metallic_1, metallic_2, metallic_3, metallic_4;
-unsigned int roughness_0, roughness_1, roughness_2, roughness_3, roughness_4;
-unsigned int ao_0, ao_1, ao_2, ao_3, ao_4;
+// unit of every sampler the frame's programs declare: the material arrays (or the G-buffer in the deferred
+// lighting pass) first, then the IBL maps and light clusters. the skybox has its cubemap alone on 0
+struct ProgramSampler
+{
+	const char* name;
+	int unit;
+};
+const ProgramSampler programSamplers[] =
+{
+	{ "albedoMap", 0 }, { "normalMap", 1 }, { "ormMap", 2 },
+	{ "gAlbedoAO", 0 }, { "gNormalMaterial", 1 }, { "gDepth", 2 },
+	{ "irradianceMap", 3 }, { "prefilterMap", 4 }, { "brdfLUT", 5 },
+	{ "lightData", 6 }, { "clusterLights", 7 }, { "lightIndices", 8 },
+	{ "environmentMap", 0 }
+};
 
-int textureMapVars[5][5] =
+const char* textureSetNames[5] = { "cobble", "space", "rusted", "granite", "wood" };
+const char* textureMapNames[5] = { "albedo", "normal", "metallic", "roughness", "ao" };
+const char* compressedMapNames[MATERIAL_MAP_COUNT] = { "albedo", "normal", "orm" };		// what TextureTool writes for a set
+
+// shown while a map is still streaming in (or if it is missing): mid grey, flat normal, dielectric, half rough, unoccluded
+const glm::vec4 texturePlaceholders[5] =
 {
-	{albedo_0, albedo_1, albedo_2, albedo_3, albedo_4},
-	{normal_0, normal_1, normal_2, normal_3, normal_4},
-	{metallic_0, metallic_1, metallic_2, metallic_3, metallic_4},
-	{roughness_0, roughness_1, roughness_2, roughness_3, roughness_4},
-	{ao_0, ao_1, ao_2, ao_3, ao_4},
+	glm::vec4(0.5f, 0.5f, 0.5f, 1.0f),
+	glm::vec4(0.5f, 0.5f, 1.0f, 1.0f),
+	glm::vec4(0.0f, 0.0f, 0.0f, 1.0f),
+	glm::vec4(0.5f, 0.5f, 0.5f, 1.0f),
+	glm::vec4(1.0f, 1.0f, 1.0f, 1.0f)
 };
 
 
-int main()
+int main(int argc, char** argv)
 {
+	// command line, benchmarks run instead of the demo
+	//==================================================
+	bool benchmarkTextures = false;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--bench-textures") == 0)
+		{
+			benchmarkTextures = true;
+		}
+		else if (strcmp(argv[i], "--spheres") == 0 && i + 1 < argc)
+		{
+			sphereCount = std::max(1, atoi(argv[++i]));
+		}
+		else if (strcmp(argv[i], "--per-draw") == 0)
+		{
+			instancedRendering = false;
+		}
+		else if (strcmp(argv[i], "--ibl-samples") == 0 && i + 1 < argc)
+		{
+			int samples = std::max(1, atoi(argv[++i]));
+			iblSettings.irradianceSampleCount = samples;
+			iblSettings.prefilterSampleCount = samples;
+			iblSettings.brdfSampleCount = samples;
+		}
+		else if (strcmp(argv[i], "--headless") == 0)
+		{
+			headless = true;
+		}
+		else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+		{
+			headlessSettings.frameCount = std::max(1, atoi(argv[++i]));
+		}
+		else if (strcmp(argv[i], "--dump-every") == 0 && i + 1 < argc)
+		{
+			headlessSettings.dumpEvery = std::max(0, atoi(argv[++i]));
+		}
+		else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+		{
+			headlessSettings.outputDir = argv[++i];
+		}
+		else if (strcmp(argv[i], "--profile") == 0)
+		{
+			printProfile = true;
+		}
+		else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+		{
+			traceFile = argv[++i];
+			profiler.setTracing(true);
+		}
+		else if (strcmp(argv[i], "--lights") == 0 && i + 1 < argc)
+		{
+			extraLightCount = std::min(std::max(0, atoi(argv[++i])), 65535);	// light indices are 16 bit
+		}
+		else if (strcmp(argv[i], "--deferred") == 0)
+		{
+			deferredShading = true;
+		}
+		else if (strcmp(argv[i], "--bench-deferred") == 0)
+		{
+			benchmarkDeferred = true;
+		}
+		else if (strcmp(argv[i], "--depth-prepass") == 0)
+		{
+			depthPrePass = true;
+		}
+		else if (strcmp(argv[i], "--no-culling") == 0)
+		{
+			frustumCulling = false;
+		}
+		else if (strcmp(argv[i], "--no-lod") == 0)
+		{
+			sphereLods = false;
+		}
+		else if (strcmp(argv[i], "--no-program-cache") == 0)
+		{
+			programCache = false;
+		}
+		else if (strcmp(argv[i], "--no-bindless") == 0)
+		{
+			bindlessTextures = false;
+		}
+		else if (strcmp(argv[i], "--no-indirect") == 0)
+		{
+			multiDrawIndirect = false;
+		}
+		else if (strcmp(argv[i], "--unsorted") == 0)
+		{
+			frontToBack = false;
+		}
+		else if (strcmp(argv[i], "--decode-textures") == 0)
+		{
+			decodeTextures = true;
+		}
+		else if (strcmp(argv[i], "--derivative-tangents") == 0)
+		{
+			derivativeTangents = true;
+		}
+		else if (strcmp(argv[i], "--no-hot-reload") == 0)
+		{
+			hotReload = false;
+		}
+	}
+
+	// the shading benchmark spreads --frames over its cases, rendered through the headless path
+	std::vector<ShadingBenchmarkCase> benchmarkCases;
+	int benchmarkFramesPerCase = 0;
+	if (benchmarkDeferred)
+	{
+		benchmarkCases = shadingBenchmarkCases();
+		benchmarkFramesPerCase = std::max(3, headlessSettings.frameCount / (int)benchmarkCases.size());
+		headless = true;
+		headlessSettings.frameCount = benchmarkFramesPerCase * (int)benchmarkCases.size();
+		headlessSettings.dumpEvery = 0;
+	}
+
 	// initialize GLFW, set version and set to core profile
 	//=====================================================
-	glfwInit();
+	if (!glfwInit())
+	{
+		std::cout << "Failed to initialize GLFW";
+		if (headless)
+		{
+			std::cout << ", without a display headless runs need a GLFW built for OSMesa (GLFW_USE_OSMESA)";
+		}
+		std::cout << std::endl;
+		return -1;
+	}
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
 	glfwWindowHint(GLFW_SAMPLES, 4); // MSAA
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	if (headless)
+	{
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);	// everything is drawn offscreen, with OSMesa there is no window at all
+	}
 
 
 	// create GLFW window object
 	//==========================
-	GLFWwindow* window = glfwCreateWindow(scr_width, scr_height, "PBR Demo", NULL, NULL);
+	// headless runs try OSMesa first so they can render in software on machines without a GPU, then EGL and
+	// the native API. a context API GLFW wasn't built with just fails to create the window
+	GLFWwindow* window = NULL;
+	const int contextAPIs[3] = { GLFW_OSMESA_CONTEXT_API, GLFW_EGL_CONTEXT_API, GLFW_NATIVE_CONTEXT_API };
+	const char* const contextAPINames[3] = { "OSMesa", "EGL", "native" };
+	for (int i = headless ? 0 : 2; i < 3 && window == NULL; ++i)
+	{
+		glfwWindowHint(GLFW_CONTEXT_CREATION_API, contextAPIs[i]);
+		window = glfwCreateWindow(scr_width, scr_height, "PBR Demo", NULL, NULL);
+		if (window != NULL && headless)
+		{
+			std::cout << "Headless context: " << contextAPINames[i] << std::endl;
+		}
+	}
 	if (window == NULL)
 	{
-		std::cout << "Failed to create GLFW window" << std::endl;
+		std::cout << "Failed to create GLFW window with an OpenGL 4.0 core context" << std::endl;
 		glfwTerminate();
 		return -1;
 	}
@@ -91,144 +337,154 @@ int main()
 		std::cout << "Failed to initialize GLAD" << std::endl;
 		return -1;
 	}
+	loadGLCaps((GLADloadproc)glfwGetProcAddress);
+	profiler.setPipelineStatistics(printProfile);	// fragment shader invocations per pass, where the driver can count them
+
+	if (benchmarkTextures)
+	{
+		benchmarkTextureLoading();
+		glfwTerminate();
+		return 0;
+	}
 
 	// OpenGL Settings
 	//================
 	glEnable(GL_DEPTH_TEST);										// enable depth testing
 	glDepthFunc(GL_LEQUAL);
+	glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);							// filter across cubemap faces, the rough prefilter mips need it
 	
 
 	// SHADERS
 	//=========
-	// create a shader program using the supplied vertex and fragment shaders
-	Shader shader_PBR("PBR Project/PBR Demo/Shaders/vs_PBR.glsl", "PBR Project/PBR Demo/Shaders/fs_PBR.glsl");
-	Shader shader_equirectangularToCubemap("PBR Project/PBR Demo/Shaders/vs_PBR-IBL.glsl", "PBR Project/PBR Demo/Shaders/fs_PBR-IBL.glsl");
-	Shader shader_skybox("PBR Project/PBR Demo/Shaders/vs_HDR-Skybox.glsl", "PBR Project/PBR Demo/Shaders/fs_HDR-Skybox.glsl");
-
-	shader_PBR.use();
-	shader_PBR.setInt("albedoMap", 0);
-	shader_PBR.setInt("normalMap", 1);
-	shader_PBR.setInt("metallicMap", 2);
-	shader_PBR.setInt("roughnessMap", 3);
-	shader_PBR.setInt("aoMap", 4);
-	shader_PBR.setInt("irradianceMap", 5);
+	// every program is submitted here and built on the driver's threads while the textures and IBL load, or
+	// loaded from the binary it was linked to last run. finishProgram() waits for one and sets its static uniforms
+	Shader::setProgramCache(programCache);
+	if (glCaps.parallelShaderCompile)
+	{
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);	// as many as the driver likes
+	}
+	double shaderStartTime = glfwGetTime();
+	// the sphere programs are all variants of vs_PBR/fs_PBR. the ones this run is going to draw with are
+	// submitted now, any other is built the first time a pass asks for it
+	ShaderPermutations sphereShaders(shaderPath("vs_PBR").c_str(), shaderPath("fs_PBR").c_str(), sphereShaderKeywords());
+	bindlessTextures = bindlessTextures && glCaps.bindlessTexture;		// material arrays read through resident handles where the driver has them
+	std::uint32_t materialFeatures = (bindlessTextures ? SPHERE_BINDLESS_TEXTURES : 0) | (derivativeTangents ? SPHERE_DERIVATIVE_TANGENTS : 0);
+	std::vector<Shader*> programs;
+	programs.push_back(&sphereShaders.variant(materialFeatures, SHADER_BUILD_ASYNC));
+	if (deferredShading || benchmarkDeferred)
+	{
+		programs.push_back(&sphereShaders.variant(materialFeatures | SPHERE_GBUFFER, SHADER_BUILD_ASYNC));
+	}
+	if (depthPrePass)
+	{
+		programs.push_back(&sphereShaders.variant(SPHERE_DEPTH_ONLY, SHADER_BUILD_ASYNC));
+	}
+	Shader& shader_PBR = *programs[0];
+	Shader shader_skybox(shaderPath("vs_HDR-Skybox").c_str(), shaderPath("fs_HDR-Skybox").c_str(), std::vector<std::string>(), SHADER_BUILD_ASYNC);
+	Shader shader_deferred(shaderPath("vs_PBR-BRDF").c_str(), shaderPath("fs_PBR-Deferred").c_str(), std::vector<std::string>(), SHADER_BUILD_ASYNC);
+	programs.push_back(&shader_skybox);
+	programs.push_back(&shader_deferred);
+	double shaderSubmitTime = glfwGetTime() - shaderStartTime;
 
-	shader_skybox.use();
-	shader_skybox.setInt("environmentMap", 0);
+	int uniformBufferAlignment;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformBufferAlignment);
+	RingBuffer frameUniformRing(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), uniformBufferAlignment);
 
 
 	// TEXTURES
 	//=========
-	loadTextureSet("cobble", 0);	// loads a set of texture maps for each texture
-	loadTextureSet("space", 1);
-	loadTextureSet("rusted", 2);
-	loadTextureSet("granite", 3);
-	loadTextureSet("wood", 4);
-
-
-	// lights
-	//=======
-	glm::vec3 lightPos[] = 
-	{
-		glm::vec3(0.0f, 0.0f, 10.0f)
-	};
-
-	glm::vec3 lightCol[] = 
+	// block compressed DDS files from TextureTool go straight into the arrays when every set has them.
+	// otherwise the PNGs are decoded on worker threads while the rest of startup carries on, placeholders are drawn until they arrive
+	const int materialLayerSize = 1024;
+	bool compressedTextures = true;
+	for (int i = 0; i < 5; ++i)
 	{
-		glm::vec3(150.0f, 150.0f, 150.0f)
-	};
-
-	int sphereCount = 5;
-	float spacing = 2.5;
+		compressedTextures = compressedTextures && compressedTextureSetAvailable(textureSetNames[i], materialLayerSize);
+	}
 
-	// PBR
-	//======
-	//framebuffers
-	unsigned int captureFBO, captureRBO;
-	glGenFramebuffers(1, &captureFBO);
-	glGenRenderbuffers(1, &captureRBO);
-
-	glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-	glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 512, 512);
-	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, captureRBO);
-
-	// hdr	
-	stbi_set_flip_vertically_on_load(true);
-	int width, height, nrComponents;
-	float* data = stbi_loadf("PBR Project/PBR Demo/Textures/hdr/Lobby-Center_Env.hdr", &width, &height, &nrComponents, 0);
-	unsigned int hdrTexture;
-	if (data)
+	TextureStreamer textureStreamer;
+	MaterialLibrary materials(5, materialLayerSize, compressedTextures && glCaps.textureCompressionBPTC && !decodeTextures);
+	for (int i = 0; i < 5; ++i)
 	{
-		glGenTextures(1, &hdrTexture);
-		glBindTexture(GL_TEXTURE_2D, hdrTexture);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, width, height, 0, GL_RGB, GL_FLOAT, data);
-
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		stbi_image_free(data);
+		if (compressedTextures)
+		{
+			loadCompressedTextureSet(materials, textureSetNames[i], i);
+		}
+		else
+		{
+			loadTextureSet(textureStreamer, materials, textureSetNames[i], i);	// loads a set of texture maps for each texture
+		}
 	}
-	else
+	materials.refresh();	// placeholders into the texture arrays
+	if (compressedTextures)
 	{
-		std::cout << "Failed to load HDR image." << std::endl;
+		std::cout << "Material textures: BC7/BC5 DDS, " << (glCaps.textureCompressionBPTC && !decodeTextures ? "sampled compressed" : "decoded on the CPU") << std::endl;
 	}
-
-	// cubemap
-	unsigned int envCubemap;
-	glGenTextures(1, &envCubemap);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
-	for (unsigned int i = 0; i < 6; ++i)
+	if (bindlessTextures)
 	{
-		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, 512, 512, 0, GL_RGB, GL_FLOAT, nullptr);
+		materials.makeResident();
 	}
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	std::cout << "Material arrays: " << (materials.isResident() ? "resident, sampled through bindless handles" : "bound to texture units") << std::endl;
+	std::cout << "Normal mapping: " << (derivativeTangents ? "tangent frame from screen space derivatives" : "per-vertex tangents") << std::endl;
 
-	// projection/view matrices
-	glm::mat4 captureProjection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 10.0f);
-	glm::mat4 captureViews[] =
-	{
-	   glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-	   glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(-1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-	   glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f,  1.0f,  0.0f), glm::vec3(0.0f,  0.0f,  1.0f)),
-	   glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f,  0.0f), glm::vec3(0.0f,  0.0f, -1.0f)),
-	   glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f,  0.0f,  1.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-	   glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f,  0.0f, -1.0f), glm::vec3(0.0f, -1.0f,  0.0f))
-	};
 
-	// convert HDR equirectangular environment map to cubemap equivalent
-	shader_equirectangularToCubemap.use();
-	shader_equirectangularToCubemap.setInt("equirectangularMap", 0);
-	shader_equirectangularToCubemap.setMat4("projection", captureProjection);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, hdrTexture);
+	float spacing = 2.5;
+	std::vector<SphereInstance> sphereInstances = layoutSpheres(sphereCount, spacing, materials.count());
+
+	// lights
+	//=======
+	// binned into clusters every frame, each fragment only shades the lights that reach it
+	std::vector<PointLight> lights = sceneLights(extraLightCount, sphereInstances);
+	LightClusters lightClusters;
+	GBuffer gBuffer;
 
-	glViewport(0, 0, 512, 512); // configure the viewport to the capture dimensions.
-	glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-	for (unsigned int i = 0; i < 6; ++i)
+	std::size_t maxSphereCount = sphereInstances.size();
+	for (std::size_t i = 0; i < benchmarkCases.size(); ++i)
 	{
-		shader_equirectangularToCubemap.setMat4("view", captureViews[i]);
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, envCubemap, 0);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		maxSphereCount = std::max(maxSphereCount, (std::size_t)benchmarkCases[i].spheres);
+	}
+	RingBuffer sphereInstanceRing(GL_ARRAY_BUFFER, maxSphereCount * sizeof(SphereInstance));
+	RingBuffer sphereIndirectRing(GL_DRAW_INDIRECT_BUFFER, sphereLodCount * sizeof(DrawElementsIndirectCommand));
+
+	// every LOD in one glMultiDrawElementsIndirect where the driver has it (GL 4.3 or ARB_multi_draw_indirect with base instance)
+	multiDrawIndirect = multiDrawIndirect && instancedRendering && glCaps.multiDrawIndirect;
+	std::cout << "Sphere draws: " << (!instancedRendering ? "one per sphere" : multiDrawIndirect ? "multi-draw indirect" : "instanced, one per LOD") << std::endl;
+	std::vector<SphereInstance> drawLists[sphereLodCount];		// this frame's spheres by level of detail, each in draw order
+	std::vector<int> sphereLodLevels(sphereInstances.size(), -1);	// per sphere, the level it was last drawn at
+	SceneBVH sphereBVH;
+	sphereBVH.build(sphereBounds(sphereInstances));
+	std::vector<int> visibleSpheres;
 
-		renderCube(); // renders a 1x1 cube
+	// PBR
+	//======
+	// image based lighting, baked from the HDR environment on the first run and cached next to it after that
+	const std::string hdrPath = "PBR Project/PBR Demo/Textures/hdr/Lobby-Center_Env.hdr";
+	IBLMaps ibl = loadIBL(hdrPath.c_str(), iblSettings);
+	profiler.flush();							// nothing is drawn yet, so the first bake's timings can be waited for and shown now
+	profiler.printSummary(std::cout, "IBL ");	// prints nothing when the maps came from the cache
+
+	// the first frame can't be drawn without these. the others are picked up by the frame loop once they're
+	// ready, until then the depth pre-pass is drawn with the PBR program (every variant's position is invariant)
+	double shaderWaitStart = glfwGetTime();
+	finishProgram(shader_PBR);
+	finishProgram(shader_skybox);
+	if (deferredShading || benchmarkDeferred)
+	{
+		finishProgram(sphereShaders.variant(materialFeatures | SPHERE_GBUFFER));
+		finishProgram(shader_deferred);
 	}
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	int cachedPrograms = 0;
+	for (std::size_t i = 0; i < programs.size(); ++i)
+	{
+		cachedPrograms += programs[i]->loadedFromCache() ? 1 : 0;
+	}
+	std::cout << "Shaders submitted in " << shaderSubmitTime * 1000.0 << " ms, waited " << (glfwGetTime() - shaderWaitStart) * 1000.0 << " ms for the first frame's, "
+		<< cachedPrograms << " of " << programs.size() << " programs from the binary cache" << (glCaps.parallelShaderCompile ? ", compiling in parallel" : "") << std::endl;
 
 
 	// initialize static shader uniforms before rendering
 	//===================================================
 	glm::mat4 projectionMatrix = glm::perspective(glm::radians(camera.Zoom), (float)scr_width / (float)scr_height, 0.1f, 100.0f);
-	shader_PBR.use();
-	shader_PBR.setMat4("projection", projectionMatrix);
-	shader_skybox.use();
-	shader_skybox.setMat4("projection", projectionMatrix);
 
 	// then before rendering, configure the viewport to the original framebuffer's screen dimensions
 	int scrWidth, scrHeight;
@@ -236,186 +492,549 @@ int main()
 	glViewport(0, 0, scrWidth, scrHeight);
 
 
-	// RENDER LOOP
-	//============
-	while (!glfwWindowShouldClose(window))
-	{
-		// time
-		float currentFrame = glfwGetTime();
-		deltaTime = currentFrame - lastFrame;
-		lastFrame = currentFrame;
+	// uniforms set every frame, resolved once here
 
-		// input
-		processInput(window); 
-		
-		// rendering
-		glClearColor(0.2f, 0.2f, 0.2f, 1.0f);					// set the colour with which the buffer will be cleared
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);		// clear the buffer
+	// RENDER QUEUE
+	//=============
+	// every pass, program and set of textures the frame draws with, registered once
+	RenderQueue renderQueue;
 
-		// model/view matrix transformations
-		shader_PBR.use();
-		glm::mat4 viewMatrix = camera.GetViewMatrix();
-		shader_PBR.setMat4("view", viewMatrix);
-		shader_PBR.setVec3("viewPos", camera.Position);
+	RenderPass depthPass;
+	depthPass.name = "depth pre-pass";
+	depthPass.colourWrite = false;
+	renderQueue.setPass(PASS_DEPTH, depthPass);
 
-		// draw spheres
-		glm::mat4 modelMatrix = glm::mat4(1.0f);
-		for (int i = 0; i < sphereCount; ++i)
+	RenderPass opaquePass;
+	opaquePass.name = "opaque";
+	if (depthPrePass)
+	{
+		opaquePass.depthFunc = GL_EQUAL;	// the depth buffer already holds the nearest surface, only fragments on it get shaded
+		opaquePass.depthWrite = false;
+	}
+	renderQueue.setPass(PASS_OPAQUE, opaquePass);
+
+	RenderPass lightSpherePass = opaquePass;
+	lightSpherePass.name = "light sphere";
+	renderQueue.setPass(PASS_LIGHT_SPHERE, lightSpherePass);
+
+	RenderPass lightingPass;				// the G-buffer's depth goes along so the skybox only fills the background
+	lightingPass.name = "deferred lighting";
+	lightingPass.depthFunc = GL_ALWAYS;
+	lightingPass.begin = [&gBuffer]() { gBuffer.end(); };
+	renderQueue.setPass(PASS_LIGHTING, lightingPass);
+
+	RenderPass skyPass;
+	skyPass.name = "skybox";
+	renderQueue.setPass(PASS_SKY, skyPass);
+
+	int program_deferred = renderQueue.addProgram(shader_deferred.ID);
+	int program_skybox = renderQueue.addProgram(shader_skybox.ID);
+
+	// sphere variants get a queue program the first time a pass draws with one. a depth only variant that is
+	// still building is stood in for by the PBR program, any other is waited for
+	std::unordered_map<Shader*, int> sphereVariantPrograms;
+	std::vector<std::pair<Shader*, int> > pendingPrograms;		// drawn with a stand-in until they finish
+	if (!shader_deferred.isFinished())
+	{
+		pendingPrograms.push_back(std::make_pair(&shader_deferred, program_deferred));
+	}
+	auto sphereVariant = [&](std::uint32_t features) -> int
+	{
+		Shader& shader = sphereShaders.variant(features, SHADER_BUILD_ASYNC);
+		std::unordered_map<Shader*, int>::const_iterator found = sphereVariantPrograms.find(&shader);
+		if (found != sphereVariantPrograms.end())
 		{
-			glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, textureMapVars[0][i]);
-			glActiveTexture(GL_TEXTURE1);
-			glBindTexture(GL_TEXTURE_2D, textureMapVars[1][i]);
-			glActiveTexture(GL_TEXTURE2);
-			glBindTexture(GL_TEXTURE_2D, textureMapVars[2][i]);
-			glActiveTexture(GL_TEXTURE3);
-			glBindTexture(GL_TEXTURE_2D, textureMapVars[3][i]);
-			glActiveTexture(GL_TEXTURE4);
-			glBindTexture(GL_TEXTURE_2D, textureMapVars[4][i]);
-
-			modelMatrix = glm::mat4(1.0f);
-			modelMatrix = glm::translate(modelMatrix, glm::vec3((float)(i - (sphereCount / 2)) * spacing, 0.0f, 0.0f));
-
-			shader_PBR.setMat4("model", modelMatrix);
-			renderSphere();
+			return found->second;
 		}
 
-		// draw light
-		shader_PBR.setVec3("lightPos[0]", lightPos[0]);
-		shader_PBR.setVec3("lightCol[0]", lightCol[0]);
-
-		modelMatrix = glm::mat4(1.0f);
-		modelMatrix = glm::translate(modelMatrix, lightPos[0]);
-		modelMatrix = glm::scale(modelMatrix, glm::vec3(1.0f));
-		shader_PBR.setMat4("model", modelMatrix);
-
-		renderSphere();
+		int program;
+		if ((features & SPHERE_DEPTH_ONLY) && !shader.isFinished() && !shader.isReady())
+		{
+			program = renderQueue.addProgram(shader_PBR.ID);
+			pendingPrograms.push_back(std::make_pair(&shader, program));
+		}
+		else
+		{
+			finishProgram(shader);
+			program = renderQueue.addProgram(shader.ID);
+		}
+		sphereVariantPrograms[&shader] = program;
+		return program;
+	};
 
-		// render skybox
-		shader_skybox.use();
-		shader_skybox.setMat4("view", viewMatrix);
+	// every material map is in a texture array, bound once for all spheres (or resident, and never bound), the IBL maps and light clusters follow them
+	int bindings_materials = RenderQueue::noBindings;
+	int bindings_forward;
+	if (materials.isResident())
+	{
+		bindings_forward = renderQueue.addBindings([&ibl, &lightClusters]() { bindLighting(ibl, lightClusters); });
+	}
+	else
+	{
+		bindings_materials = renderQueue.addBindings([&materials]() { materials.bind(0); });
+		bindings_forward = renderQueue.addBindings([&materials, &ibl, &lightClusters]() { materials.bind(0); bindLighting(ibl, lightClusters); });
+	}
+	int bindings_deferred = renderQueue.addBindings([&gBuffer, &ibl, &lightClusters]() { gBuffer.bind(0); bindLighting(ibl, lightClusters); });
+	int bindings_skybox = renderQueue.addBindings([&ibl]()
+	{
 		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
-		renderCube();
+		glBindTexture(GL_TEXTURE_CUBE_MAP, ibl.envCubemap);
+	});
 
+	std::vector<unsigned int> uploadedTextures;		// streamed in since the last refresh, only their layers are redrawn
 
-		// check for and call events, swap buffers
-		glfwPollEvents();
-		glfwSwapBuffers(window);
+	// headless runs draw every frame fully textured so their images are reproducible
+	std::unique_ptr<HeadlessRun> headlessRun;
+	if (headless)
+	{
+		textureStreamer.finish(&uploadedTextures);
+		materials.sourcesChanged(uploadedTextures);
+		materials.refresh();
+		headlessRun.reset(new HeadlessRun(headlessSettings, scr_width, scr_height));
 	}
 
-	shader_PBR.stopUsing();
+	// HOT RELOAD
+	//===========
+	// every file the frame is built from is watched, and only what was rebuilt from a changed file is replaced:
+	// the programs built from a shader, one material map, or the IBL maps when the HDR itself changes
+	AssetWatcher assetWatcher;
+	std::vector<std::string> changedAssets;
+	hotReload = hotReload && !headless;
+	auto watchShaders = [&]()		// again after every rebuild, for anything newly included
+	{
+		for (std::size_t i = 0; i < programs.size(); ++i)
+		{
+			std::vector<std::string> files = programs[i]->sourceFiles();
+			for (std::size_t file = 0; file < files.size(); ++file)
+			{
+				assetWatcher.watch(files[file]);
+			}
+		}
+	};
+	if (hotReload)
+	{
+		watchShaders();
+		for (int i = 0; i < 5; ++i)
+		{
+			for (int map = 0; map < (compressedTextures ? (int)MATERIAL_MAP_COUNT : 5); ++map)
+			{
+				assetWatcher.watch(compressedTextures ? textureMapPath(textureSetNames[i], compressedMapNames[map], ".dds") : textureMapPath(textureSetNames[i], textureMapNames[map]));
+			}
+		}
+		assetWatcher.watch(hdrPath);
+		std::cout << "Hot reload: " << (assetWatcher.isWatching() ? "watching shaders, material maps and the HDR" : "file watching unavailable") << std::endl;
+	}
 
-	// deallocate glfw resources
-	glfwTerminate();
-	return 0;
-}
+	// a program whose new build fails keeps drawing with its old one. images are decoded again on the streamer's
+	// workers and uploaded into the texture they had, the material arrays pick them up on their next refresh
+	auto reloadAsset = [&](const std::string& path)
+	{
+		double startTime = glfwGetTime();
+		if (path.size() > 5 && path.compare(path.size() - 5, 5, ".glsl") == 0)
+		{
+			forgetShaderFile(path);
+			int rebuilt = sphereShaders.reload(path);
+			if (rebuilt > 0)
+			{
+				for (std::unordered_map<Shader*, int>::const_iterator i = sphereVariantPrograms.begin(); i != sphereVariantPrograms.end(); ++i)
+				{
+					finishProgram(*i->first);
+					renderQueue.setProgram(i->second, i->first->ID);
+				}
+			}
 
+			Shader* shaders[] = { &shader_skybox, &shader_deferred };
+			int shaderPrograms[] = { program_skybox, program_deferred };
+			for (int i = 0; i < 2; ++i)
+			{
+				if (shaders[i]->readsFile(path) && shaders[i]->reload())
+				{
+					finishProgram(*shaders[i]);
+					renderQueue.setProgram(shaderPrograms[i], shaders[i]->ID);
+					++rebuilt;
+				}
+			}
+			watchShaders();
+			std::cout << "Reloaded " << path << ": " << rebuilt << " programs rebuilt in " << (glfwGetTime() - startTime) * 1000.0 << " ms" << std::endl;
+		}
+		else if (path == hdrPath)
+		{
+			// baked again only if the HDR's contents changed, the bake cache is keyed on them
+			IBLMaps reloaded = loadIBL(hdrPath.c_str(), iblSettings);
+			deleteIBLMaps(ibl);
+			ibl = reloaded;
+
+			int width, height;
+			glfwGetFramebufferSize(window, &width, &height);
+			glViewport(0, 0, width, height);	// the bake leaves its capture size set
+		}
+		else if (textureStreamer.reload(path))
+		{
+			std::cout << "Reloading " << path << std::endl;
+		}
+		else
+		{
+			for (int i = 0; i < 5; ++i)
+			{
+				for (int map = 0; map < MATERIAL_MAP_COUNT; ++map)
+				{
+					if (path == textureMapPath(textureSetNames[i], compressedMapNames[map], ".dds") && loadCompressedMap(materials, textureSetNames[i], i, (MaterialMap)map))
+					{
+						std::cout << "Reloaded " << path << " in " << (glfwGetTime() - startTime) * 1000.0 << " ms" << std::endl;
+					}
+				}
+			}
+		}
+	};
 
-// FUNCTIONS
-//==========
-unsigned int sphereVAO = 0;
-unsigned int indexCount;
-// function for rendering spheres from LearnOpenGL
-void renderSphere()	
-{
-	if (sphereVAO == 0)
+	float lastProfilePrint = 0.0f;
+	int frameNumber = 0;
+
+	// RENDER LOOP
+	//============
+	while (headlessRun ? !headlessRun->done() : !glfwWindowShouldClose(window))
 	{
-		glGenVertexArrays(1, &sphereVAO);
+		profiler.beginFrame();
+		double frameStart = glfwGetTime();
+
+		// time
+		float currentFrame = glfwGetTime();
+		deltaTime = currentFrame - lastFrame;
+		lastFrame = currentFrame;
+
+		// input, or the next pose on the fixed camera path
+		if (headlessRun)
+		{
+			headlessRun->beginFrame(camera);
+
+			// each benchmark case rebuilds the scene, then holds the camera where it sees every sphere
+			if (benchmarkDeferred)
+			{
+				const ShadingBenchmarkCase& benchmarkCase = benchmarkCases[frameNumber / benchmarkFramesPerCase];
+				if (frameNumber % benchmarkFramesPerCase == 0)
+				{
+					sphereInstances = layoutSpheres(benchmarkCase.spheres, spacing, materials.count());
+					lights = sceneLights(benchmarkCase.lights, sphereInstances);
+					sphereBVH.build(sphereBounds(sphereInstances));
+					sphereLodLevels.assign(sphereInstances.size(), -1);
+					deferredShading = benchmarkCase.deferred;
+				}
+				float gridHalfWidth = ceilf(sqrtf((float)benchmarkCase.spheres)) * spacing * 0.5f;
+				camera = Camera(glm::vec3(0.0f, 0.0f, std::max(8.0f, gridHalfWidth * 2.6f)));
+			}
+		}
+		else
+		{
+			processInput(window);
+		}
 
-		unsigned int vbo, ebo;
-		glGenBuffers(1, &vbo);
-		glGenBuffers(1, &ebo);
+		// programs the first frame didn't wait for, swapped into the queue as they finish building
+		for (std::size_t i = 0; i < pendingPrograms.size(); ++i)
+		{
+			Shader& shader = *pendingPrograms[i].first;
+			if (shader.isReady())
+			{
+				finishProgram(shader);
+				renderQueue.setProgram(pendingPrograms[i].second, shader.ID);
+				pendingPrograms.erase(pendingPrograms.begin() + i--);
+			}
+		}
 
-		std::vector<glm::vec3> positions;
-		std::vector<glm::vec2> uv;
-		std::vector<glm::vec3> normals;
-		std::vector<unsigned int> indices;
+		// anything saved since the last frame
+		if (hotReload)
+		{
+			assetWatcher.poll(changedAssets);
+			for (std::size_t i = 0; i < changedAssets.size(); ++i)
+			{
+				reloadAsset(changedAssets[i]);
+			}
+		}
 
-		const unsigned int X_SEGMENTS = 64;
-		const unsigned int Y_SEGMENTS = 64;
-		const float PI = 3.14159265359f;
-		for (unsigned int y = 0; y <= Y_SEGMENTS; ++y)
+		// finish any textures that have been decoded since the last frame
 		{
-			for (unsigned int x = 0; x <= X_SEGMENTS; ++x)
+			ProfileScope scope(profiler, "texture upload");
+			uploadedTextures.clear();
+			if (textureStreamer.update(&uploadedTextures) > 0)
 			{
-				float xSegment = (float)x / (float)X_SEGMENTS;
-				float ySegment = (float)y / (float)Y_SEGMENTS;
+				materials.sourcesChanged(uploadedTextures);
+				materials.refresh();
+			}
+		}
+		
+		// rendering
+		glClearColor(0.2f, 0.2f, 0.2f, 1.0f);					// set the colour with which the buffer will be cleared
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);		// clear the buffer
 
-				float xPos = std::cos(xSegment * 2.0f * PI) * std::sin(ySegment * PI);
-				float yPos = std::cos(ySegment * PI);
-				float zPos = std::sin(xSegment * 2.0f * PI) * std::sin(ySegment * PI);
+		// bin the lights for this view
+		glm::mat4 viewMatrix = camera.GetViewMatrix();
+		{
+			ProfileScope scope(profiler, "light clusters");
+			lightClusters.update(lights, viewMatrix, projectionMatrix);
+		}
 
-				positions.push_back(glm::vec3(xPos, yPos, zPos));
-				uv.push_back(glm::vec2(xSegment, ySegment));
-				normals.push_back(glm::vec3(xPos, yPos, zPos));
+		// per-frame uniforms, shared by every program through the FrameData block
+		FrameUniforms* frameUniforms = (FrameUniforms*)frameUniformRing.begin();
+		frameUniforms->projection = projectionMatrix;
+		frameUniforms->view = viewMatrix;
+		frameUniforms->viewPos = glm::vec4(camera.Position, 1.0f);
+		frameUniforms->inverseViewProjection = glm::inverse(projectionMatrix * viewMatrix);
+		lightClusters.writeUniforms(*frameUniforms);
+		frameUniformRing.end(sizeof(FrameUniforms));
+		glBindBufferRange(GL_UNIFORM_BUFFER, frameUniformBinding, frameUniformRing.buffer(), frameUniformRing.offset(), sizeof(FrameUniforms));
+
+		// only the spheres in the view frustum
+		if (frustumCulling)
+		{
+			ProfileScope scope(profiler, "culling", false);
+			sphereBVH.cull(projectionMatrix * viewMatrix, visibleSpheres);
+		}
+		else
+		{
+			visibleSpheres.resize(sphereInstances.size());
+			for (std::size_t i = 0; i < sphereInstances.size(); ++i)
+			{
+				visibleSpheres[i] = (int)i;
 			}
 		}
 
-		bool oddRow = false;
-		for (unsigned int y = 0; y < Y_SEGMENTS; ++y)
+		// each at the level of detail its size on screen needs, nearest first so the depth test rejects as much of the hidden shading as it can
 		{
-			if (!oddRow) // even rows: y == 0, y == 2; and so on
+			ProfileScope scope(profiler, "draw lists", false);
+			for (int lod = 0; lod < sphereLodCount; ++lod)
+			{
+				drawLists[lod].clear();
+			}
+			float pixelsPerUnit = projectionMatrix[1][1] * 0.5f * scrHeight;	// at a distance of 1
+			for (std::size_t i = 0; i < visibleSpheres.size(); ++i)
 			{
-				for (unsigned int x = 0; x <= X_SEGMENTS; ++x)
+				int sphere = visibleSpheres[i];
+				const SphereInstance& instance = sphereInstances[sphere];
+				int lod = 0;
+				if (sphereLods)
 				{
-					indices.push_back(y * (X_SEGMENTS + 1) + x);
-					indices.push_back((y + 1) * (X_SEGMENTS + 1) + x);
+					float radius = glm::length(glm::vec3(instance.model[0]));	// spheres are scaled uniformly
+					float distance = glm::length(glm::vec3(instance.model[3]) - camera.Position);
+					float screenRadius = distance > radius ? radius * pixelsPerUnit / distance : (float)scrHeight;
+					lod = selectSphereLod(screenRadius, sphereLodLevels[sphere]);
 				}
+				sphereLodLevels[sphere] = lod;
+				drawLists[lod].push_back(instance);
 			}
-			else
+			if (frontToBack)
 			{
-				for (int x = X_SEGMENTS; x >= 0; --x)
+				for (int lod = 0; lod < sphereLodCount; ++lod)
 				{
-					indices.push_back((y + 1) * (X_SEGMENTS + 1) + x);
-					indices.push_back(y * (X_SEGMENTS + 1) + x);
+					sortFrontToBack(drawLists[lod], camera.Position);
 				}
 			}
-			oddRow = !oddRow;
 		}
-		indexCount = indices.size();
 
-		std::vector<float> data;
-		for (std::size_t i = 0; i < positions.size(); ++i)
+		// the levels back to back in one region of the instance ring, one draw each
+		unsigned int instanceBuffer = 0;	// 0 draws them one at a time
+		std::size_t instanceOffsets[sphereLodCount] = { 0 };
+		if (instancedRendering)
 		{
-			data.push_back(positions[i].x);
-			data.push_back(positions[i].y);
-			data.push_back(positions[i].z);
-			if (uv.size() > 0)
+			unsigned char* instances = (unsigned char*)sphereInstanceRing.begin();
+			std::size_t written = 0;
+			for (int lod = 0; lod < sphereLodCount; ++lod)
 			{
-				data.push_back(uv[i].x);
-				data.push_back(uv[i].y);
+				instanceOffsets[lod] = sphereInstanceRing.offset() + written;
+				if (!drawLists[lod].empty())
+				{
+					memcpy(instances + written, &drawLists[lod][0], drawLists[lod].size() * sizeof(SphereInstance));
+					written += drawLists[lod].size() * sizeof(SphereInstance);
+				}
 			}
-			if (normals.size() > 0)
+			sphereInstanceRing.end(written);
+			instanceBuffer = sphereInstanceRing.buffer();
+		}
+
+		// one command per non-empty level, its instances found by base instance from the start of the region
+		int indirectDraws = 0;
+		if (multiDrawIndirect)
+		{
+			DrawElementsIndirectCommand* commands = (DrawElementsIndirectCommand*)sphereIndirectRing.begin();
+			for (int lod = 0; lod < sphereLodCount; ++lod)
 			{
-				data.push_back(normals[i].x);
-				data.push_back(normals[i].y);
-				data.push_back(normals[i].z);
+				if (!drawLists[lod].empty())
+				{
+					int baseInstance = (int)((instanceOffsets[lod] - sphereInstanceRing.offset()) / sizeof(SphereInstance));
+					commands[indirectDraws++] = sphereIndirectCommand(lod, (int)drawLists[lod].size(), baseInstance);
+				}
 			}
+			sphereIndirectRing.end(indirectDraws * sizeof(DrawElementsIndirectCommand));
 		}
 
-		glBindVertexArray(sphereVAO);
-		glBindBuffer(GL_ARRAY_BUFFER, vbo);
-		glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(float), &data[0], GL_STATIC_DRAW);
+		// queue the frame's draws, the queue puts them in pass order with as few program and texture changes as it can
+		renderQueue.clear();
+		// the least each pass needs: no shading at all for depth, no lighting for the G-buffer
+		int sphereProgram = sphereVariant(materialFeatures | (deferredShading ? SPHERE_GBUFFER : 0));
+		int program_depth = depthPrePass ? sphereVariant(SPHERE_DEPTH_ONLY) : 0;
+		int sphereBindings = deferredShading ? bindings_materials : bindings_forward;
+		if (indirectDraws > 0)
+		{
+			DrawCommand command = DrawCommand::spheresIndirect(instanceBuffer, sphereInstanceRing.offset(), sphereIndirectRing.buffer(), sphereIndirectRing.offset(), indirectDraws);
+			float depth = 1e30f;
+			for (int lod = 0; lod < sphereLodCount; ++lod)
+			{
+				if (!drawLists[lod].empty())
+				{
+					depth = std::min(depth, glm::length(glm::vec3(drawLists[lod][0].model[3]) - camera.Position));
+				}
+			}
+			if (depthPrePass)
+			{
+				renderQueue.submit(PASS_DEPTH, program_depth, RenderQueue::noBindings, depth, command);
+			}
+			renderQueue.submit(PASS_OPAQUE, sphereProgram, sphereBindings, depth, command);
+		}
+		for (int lod = 0; lod < sphereLodCount && indirectDraws == 0; ++lod)
+		{
+			const std::vector<SphereInstance>& instances = drawLists[lod];
+			if (instances.empty())
+			{
+				continue;
+			}
+			if (instancedRendering)
+			{
+				DrawCommand command = DrawCommand::spheres(instanceBuffer, instanceOffsets[lod], (int)instances.size(), lod);
+				float depth = glm::length(glm::vec3(instances[0].model[3]) - camera.Position);	// the nearest, when they're sorted
+				if (depthPrePass)
+				{
+					renderQueue.submit(PASS_DEPTH, program_depth, RenderQueue::noBindings, depth, command);
+				}
+				renderQueue.submit(PASS_OPAQUE, sphereProgram, sphereBindings, depth, command);
+				continue;
+			}
+			for (std::size_t i = 0; i < instances.size(); ++i)
+			{
+				DrawCommand command = DrawCommand::sphere(instances[i], lod);
+				float depth = glm::length(glm::vec3(instances[i].model[3]) - camera.Position);
+				if (depthPrePass)
+				{
+					renderQueue.submit(PASS_DEPTH, program_depth, RenderQueue::noBindings, depth, command);
+				}
+				renderQueue.submit(PASS_OPAQUE, sphereProgram, sphereBindings, depth, command);
+			}
+		}
+
+		// light
+		{
+			SphereInstance lightSphere;
+			lightSphere.model = glm::mat4(1.0f);
+			lightSphere.model = glm::translate(lightSphere.model, lights[0].position);
+			lightSphere.model = glm::scale(lightSphere.model, glm::vec3(1.0f));
+			lightSphere.material = materials.count() - 1;
+
+			DrawCommand command = DrawCommand::sphere(lightSphere, 0);
+			float depth = glm::length(lights[0].position - camera.Position);
+			if (depthPrePass)
+			{
+				renderQueue.submit(PASS_DEPTH, program_depth, RenderQueue::noBindings, depth, command);
+			}
+			renderQueue.submit(PASS_LIGHT_SPHERE, sphereProgram, sphereBindings, depth, command);
+		}
 
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+		// light the G-buffer into the frame
+		if (deferredShading)
+		{
+			renderQueue.submit(PASS_LIGHTING, program_deferred, bindings_deferred, 0.0f, DrawCommand::quad());
+		}
 
-		float stride = (3 + 2 + 3) * sizeof(float);
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+		// skybox
+		renderQueue.submit(PASS_SKY, program_skybox, bindings_skybox, 0.0f, DrawCommand::cube());
 
-		glEnableVertexAttribArray(1);
-		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
+		// spheres are shaded as they are drawn, or only written to the G-buffer for the deferred lighting pass
+		if (deferredShading)
+		{
+			gBuffer.begin();
+		}
+		renderQueue.execute();
+
+		frameUniformRing.fence();	// this frame's uniforms and instances can be reused once these draws complete
+		if (instancedRendering)
+		{
+			sphereInstanceRing.fence();
+		}
+		if (multiDrawIndirect)
+		{
+			sphereIndirectRing.fence();
+		}
 
-		glEnableVertexAttribArray(2);
-		glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (void*)(5 * sizeof(float)));
+
+		// check for and call events, swap buffers. headless runs wait for the frame and record it instead
+		{
+			ProfileScope scope(profiler, "swap", false);
+			if (headlessRun)
+			{
+				headlessRun->endFrame();
+			}
+			else
+			{
+				glfwPollEvents();
+				glfwSwapBuffers(window);
+			}
+		}
+
+		profiler.endFrame();
+		if (benchmarkDeferred && frameNumber % benchmarkFramesPerCase >= 2)	// the first frames of a case warm up
+		{
+			ShadingBenchmarkCase& benchmarkCase = benchmarkCases[frameNumber / benchmarkFramesPerCase];
+			benchmarkCase.totalMs += (glfwGetTime() - frameStart) * 1000.0;
+			++benchmarkCase.frames;
+		}
+		++frameNumber;
+
+		if (printProfile && currentFrame - lastProfilePrint > 2.0f)
+		{
+			profiler.printSummary();
+			std::cout << "lights " << lightClusters.lightCount() << ", light/cluster pairs " << lightClusters.assignedLightCount() << ", dropped " << lightClusters.droppedLightCount() << std::endl;
+			std::cout << "sphere LODs";
+			int indices = 0;
+			for (int lod = 0; lod < sphereLodCount; ++lod)
+			{
+				std::cout << (lod == 0 ? " " : "/") << drawLists[lod].size();
+				indices += (int)drawLists[lod].size() * sphereLodIndexCount(lod);
+			}
+			std::cout << ", " << indices << " indices" << std::endl;
+			std::cout << "render queue " << renderQueue.packetCount() << " packets, " << renderQueue.programChanges() << " program changes, " << renderQueue.bindingChanges() << " texture binding changes" << std::endl;
+			if (frustumCulling)
+			{
+				std::cout << "spheres visible " << sphereBVH.visibleCount() << ", culled " << sphereBVH.culledCount() << ", BVH nodes tested " << sphereBVH.testedNodeCount() << " of " << sphereBVH.nodeCount() << std::endl;
+			}
+			std::cout << std::endl;
+			lastProfilePrint = currentFrame;
+		}
 	}
 
-	glBindVertexArray(sphereVAO);
-	glDrawElements(GL_TRIANGLE_STRIP, indexCount, GL_UNSIGNED_INT, 0);
+	if (headlessRun)
+	{
+		headlessRun->finish();
+		headlessRun.reset();
+	}
+	if (benchmarkDeferred)
+	{
+		printShadingBenchmark(benchmarkCases);
+	}
+	profiler.flush();
+	if (printProfile)
+	{
+		profiler.printSummary();
+	}
+	if (!traceFile.empty() && !profiler.writeChromeTrace(traceFile))
+	{
+		std::cout << "Failed to write trace: " << traceFile << std::endl;
+	}
+	shader_PBR.stopUsing();
+
+	// deallocate glfw resources
+	glfwTerminate();
+	return 0;
 }
 
+
+// FUNCTIONS
+//==========
 // process inputs by checking if keys are pressed/released
 void processInput(GLFWwindow *window)
 {
@@ -517,99 +1136,283 @@ unsigned int loadTexture(char const* path)
 	return textureID;
 }
 
-void loadTextureSet(std::string setName, int i)
+std::string textureMapPath(const std::string& setName, const std::string& mapName, const std::string& extension)
+{
+	return "PBR Project/PBR Demo/Textures/" + setName + "/" + setName + "_" + mapName + extension;
+}
+
+std::string shaderPath(const std::string& name)
+{
+	return "PBR Project/PBR Demo/Shaders/" + name + ".glsl";
+}
+
+// queue every map of a set on the streamer, the material gets the texture IDs straight away.
+// metallic, roughness and ao are packed into the channels of the material's ORM layer
+void loadTextureSet(TextureStreamer& streamer, MaterialLibrary& materials, std::string setName, int i)
+{
+	unsigned int textures[5];
+	for (int map = 0; map < 5; ++map)
+	{
+		textures[map] = streamer.request(textureMapPath(setName, textureMapNames[map]), texturePlaceholders[map]);
+	}
+
+	materials.setMap(i, ALBEDO_MAP, textures[0]);
+	materials.setMap(i, NORMAL_MAP, textures[1]);
+	materials.setChannelMap(i, ORM_MAP, ORM_METALLIC, textures[2]);
+	materials.setChannelMap(i, ORM_MAP, ORM_ROUGHNESS, textures[3]);
+	materials.setChannelMap(i, ORM_MAP, ORM_OCCLUSION, textures[4]);
+}
+
+// TextureTool has packed the set and every DDS is big enough for the material arrays
+bool compressedTextureSetAvailable(const std::string& setName, int layerSize)
+{
+	for (int map = 0; map < MATERIAL_MAP_COUNT; ++map)
+	{
+		MappedFile file(textureMapPath(setName, compressedMapNames[map], ".dds"));
+		CompressedImageView image;
+		if (!file.isOpen() || !parseDDS(file.data(), file.size(), image) || image.width < layerSize || image.height < layerSize)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// upload a set's DDS files, mips and all
+bool loadCompressedTextureSet(MaterialLibrary& materials, const std::string& setName, int i)
+{
+	bool loaded = true;
+	for (int map = 0; map < MATERIAL_MAP_COUNT; ++map)
+	{
+		loaded = loadCompressedMap(materials, setName, i, (MaterialMap)map) && loaded;
+	}
+	return loaded;
+}
+
+bool loadCompressedMap(MaterialLibrary& materials, const std::string& setName, int i, MaterialMap map)
+{
+	MappedFile file(textureMapPath(setName, compressedMapNames[map], ".dds"));
+	CompressedImageView image;
+	if (!file.isOpen() || !parseDDS(file.data(), file.size(), image))
+	{
+		std::cout << "Texture failed to load at path: " << textureMapPath(setName, compressedMapNames[map], ".dds") << std::endl;
+		return false;
+	}
+	return materials.setCompressedMap(i, map, image);
+}
+
+// a single row centred on the origin for a handful of spheres, a square grid for probe counts beyond that.
+// materials are assigned round robin
+std::vector<SphereInstance> layoutSpheres(int count, float spacing, int materialCount)
+{
+	int columns = count <= 5 ? count : (int)std::ceil(std::sqrt((float)count));
+	int rows = (count + columns - 1) / columns;
+
+	std::vector<SphereInstance> instances(count);
+	for (int i = 0; i < count; ++i)
+	{
+		int column = i % columns;
+		int row = i / columns;
+
+		instances[i].model = glm::mat4(1.0f);
+		instances[i].model = glm::translate(instances[i].model, glm::vec3((float)(column - (columns / 2)) * spacing, (float)((rows / 2) - row) * spacing, 0.0f));
+		instances[i].material = i % materialCount;
+	}
+	return instances;
+}
+
+// world space boxes around the unit spheres
+std::vector<CullBounds> sphereBounds(const std::vector<SphereInstance>& instances)
+{
+	std::vector<CullBounds> bounds(instances.size());
+	for (std::size_t i = 0; i < instances.size(); ++i)
+	{
+		const glm::mat4& model = instances[i].model;
+		glm::vec3 centre(model[3]);
+		float radius = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+		bounds[i].min = centre - glm::vec3(radius);
+		bounds[i].max = centre + glm::vec3(radius);
+	}
+	return bounds;
+}
+
+// nearest sphere centre first
+void sortFrontToBack(std::vector<SphereInstance>& instances, const glm::vec3& eye)
+{
+	std::sort(instances.begin(), instances.end(), [&eye](const SphereInstance& a, const SphereInstance& b)
+	{
+		glm::vec3 toA = glm::vec3(a.model[3]) - eye;
+		glm::vec3 toB = glm::vec3(b.model[3]) - eye;
+		return glm::dot(toA, toA) < glm::dot(toB, toB);
+	});
+}
+
+// the main light above the spheres, then extraCount scattered ones
+std::vector<PointLight> sceneLights(int extraCount, const std::vector<SphereInstance>& spheres)
 {
-	std::string albedoName = "PBR Project/PBR Demo/Textures/" + setName + "/" + setName + "_albedo.png";
-	const char* charAlbedoName = albedoName.c_str();
-	textureMapVars[0][i] = loadTexture(charAlbedoName);
+	std::vector<PointLight> lights(1);
+	lights[0].position = glm::vec3(0.0f, 0.0f, 10.0f);
+	lights[0].colour = glm::vec3(150.0f, 150.0f, 150.0f);
+	lights[0].radius = pointLightRadius(lights[0].colour);
+
+	std::vector<PointLight> extraLights = scatterLights(extraCount, spheres);
+	lights.insert(lights.end(), extraLights.begin(), extraLights.end());
+	return lights;
+}
 
-	std::string normalName = "PBR Project/PBR Demo/Textures/" + setName + "/" + setName + "_normal.png";
-	const char* charNormalName = normalName.c_str();
-	textureMapVars[1][i] = loadTexture(charNormalName);
+// --lights N: small coloured lights in a slab just in front of the spheres, seeded so every run gets the same ones
+std::vector<PointLight> scatterLights(int count, const std::vector<SphereInstance>& spheres)
+{
+	glm::vec3 low(1e30f), high(-1e30f);
+	for (size_t i = 0; i < spheres.size(); ++i)
+	{
+		glm::vec3 centre(spheres[i].model[3]);
+		low = glm::min(low, centre);
+		high = glm::max(high, centre);
+	}
+	low -= glm::vec3(2.0f, 2.0f, -0.5f);
+	high += glm::vec3(2.0f, 2.0f, 3.0f);
 
-	std::string metallicName = "PBR Project/PBR Demo/Textures/" + setName + "/" + setName + "_metallic.png";
-	const char* charMetallicName = metallicName.c_str();
-	textureMapVars[2][i] = loadTexture(charMetallicName);
+	std::mt19937 random(1234);
+	std::vector<PointLight> lights(count);
+	for (int i = 0; i < count; ++i)
+	{
+		glm::vec3 t(random() / 4294967296.0f, random() / 4294967296.0f, random() / 4294967296.0f);
+		lights[i].position = low + (high - low) * t;
+
+		// a saturated hue at a modest intensity
+		float hue = random() / 4294967296.0f * 6.0f;
+		glm::vec3 colour = glm::clamp(glm::vec3(fabsf(hue - 3.0f) - 1.0f, 2.0f - fabsf(hue - 2.0f), 2.0f - fabsf(hue - 4.0f)), 0.0f, 1.0f);
+		lights[i].colour = colour * (0.5f + 1.5f * (random() / 4294967296.0f));
+		lights[i].radius = pointLightRadius(lights[i].colour);
+	}
+	return lights;
+}
+
+std::vector<std::string> sphereShaderKeywords()
+{
+	std::vector<std::string> keywords;
+	keywords.push_back("BINDLESS_TEXTURES");
+	keywords.push_back("GBUFFER");
+	keywords.push_back("DEPTH_ONLY");
+	keywords.push_back("DERIVATIVE_TANGENTS");
+	return keywords;
+}
 
-	std::string roughnessName = "PBR Project/PBR Demo/Textures/" + setName + "/" + setName + "_roughness.png";
-	const char* charRougnessName = roughnessName.c_str();
-	textureMapVars[3][i] = loadTexture(charRougnessName);
+// wait for a program submitted with SHADER_BUILD_ASYNC and set the uniforms that never change. every program
+// gets the whole list, names it doesn't declare are inactive and setting them does nothing
+void finishProgram(Shader& shader)
+{
+	shader.finish();
+	shader.use();
+	for (std::size_t i = 0; i < sizeof(programSamplers) / sizeof(programSamplers[0]); ++i)
+	{
+		shader.setInt(programSamplers[i].name, programSamplers[i].unit);
+	}
+	shader.setFloat("prefilterMaxLod", (float)(iblSettings.prefilterMipCount - 1));
 
-	std::string AOname = "PBR Project/PBR Demo/Textures/" + setName + "/" + setName + "_ao.png";
-	const char* charAOname = AOname.c_str();
-	textureMapVars[4][i] = loadTexture(charAOname);
+	// camera and lights come from one uniform buffer written once per frame
+	shader.bindUniformBlock("FrameData", frameUniformBinding);
+	shader.bindUniformBlock("MaterialTextures", materialTextureBinding);
 }
 
+// image based lighting on units 3-5 and the light clusters on 6-8, the same for the forward and deferred lighting shaders
+void bindLighting(const IBLMaps& ibl, const LightClusters& lightClusters)
+{
+	glActiveTexture(GL_TEXTURE3);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, ibl.irradianceMap);
+	glActiveTexture(GL_TEXTURE4);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, ibl.prefilterMap);
+	glActiveTexture(GL_TEXTURE5);
+	glBindTexture(GL_TEXTURE_2D, ibl.brdfLUT);
+	lightClusters.bind(6);
+}
 
-// render cube
-unsigned int cubeVAO = 0;
-unsigned int cubeVBO = 0;
-void renderCube()
+// every sphere count against every light count, forward then deferred
+std::vector<ShadingBenchmarkCase> shadingBenchmarkCases()
 {
-	if (cubeVAO == 0)
-	{
-		float vertices[] = {
-			// back face
-			-1.0f, -1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 0.0f, 0.0f, // bottom-left
-			 1.0f,  1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 1.0f, 1.0f, // top-right
-			 1.0f, -1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 1.0f, 0.0f, // bottom-right         
-			 1.0f,  1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 1.0f, 1.0f, // top-right
-			-1.0f, -1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 0.0f, 0.0f, // bottom-left
-			-1.0f,  1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 0.0f, 1.0f, // top-left
-			// front face
-			-1.0f, -1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f, 0.0f, // bottom-left
-			 1.0f, -1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f, 0.0f, // bottom-right
-			 1.0f,  1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f, 1.0f, // top-right
-			 1.0f,  1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f, 1.0f, // top-right
-			-1.0f,  1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f, 1.0f, // top-left
-			-1.0f, -1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f, 0.0f, // bottom-left
-			// left face
-			-1.0f,  1.0f,  1.0f, -1.0f,  0.0f,  0.0f, 1.0f, 0.0f, // top-right
-			-1.0f,  1.0f, -1.0f, -1.0f,  0.0f,  0.0f, 1.0f, 1.0f, // top-left
-			-1.0f, -1.0f, -1.0f, -1.0f,  0.0f,  0.0f, 0.0f, 1.0f, // bottom-left
-			-1.0f, -1.0f, -1.0f, -1.0f,  0.0f,  0.0f, 0.0f, 1.0f, // bottom-left
-			-1.0f, -1.0f,  1.0f, -1.0f,  0.0f,  0.0f, 0.0f, 0.0f, // bottom-right
-			-1.0f,  1.0f,  1.0f, -1.0f,  0.0f,  0.0f, 1.0f, 0.0f, // top-right
-			// right face
-			 1.0f,  1.0f,  1.0f,  1.0f,  0.0f,  0.0f, 1.0f, 0.0f, // top-left
-			 1.0f, -1.0f, -1.0f,  1.0f,  0.0f,  0.0f, 0.0f, 1.0f, // bottom-right
-			 1.0f,  1.0f, -1.0f,  1.0f,  0.0f,  0.0f, 1.0f, 1.0f, // top-right         
-			 1.0f, -1.0f, -1.0f,  1.0f,  0.0f,  0.0f, 0.0f, 1.0f, // bottom-right
-			 1.0f,  1.0f,  1.0f,  1.0f,  0.0f,  0.0f, 1.0f, 0.0f, // top-left
-			 1.0f, -1.0f,  1.0f,  1.0f,  0.0f,  0.0f, 0.0f, 0.0f, // bottom-left     
-			// bottom face
-			-1.0f, -1.0f, -1.0f,  0.0f, -1.0f,  0.0f, 0.0f, 1.0f, // top-right
-			 1.0f, -1.0f, -1.0f,  0.0f, -1.0f,  0.0f, 1.0f, 1.0f, // top-left
-			 1.0f, -1.0f,  1.0f,  0.0f, -1.0f,  0.0f, 1.0f, 0.0f, // bottom-left
-			 1.0f, -1.0f,  1.0f,  0.0f, -1.0f,  0.0f, 1.0f, 0.0f, // bottom-left
-			-1.0f, -1.0f,  1.0f,  0.0f, -1.0f,  0.0f, 0.0f, 0.0f, // bottom-right
-			-1.0f, -1.0f, -1.0f,  0.0f, -1.0f,  0.0f, 0.0f, 1.0f, // top-right
-			// top face
-			-1.0f,  1.0f, -1.0f,  0.0f,  1.0f,  0.0f, 0.0f, 1.0f, // top-left
-			 1.0f,  1.0f , 1.0f,  0.0f,  1.0f,  0.0f, 1.0f, 0.0f, // bottom-right
-			 1.0f,  1.0f, -1.0f,  0.0f,  1.0f,  0.0f, 1.0f, 1.0f, // top-right     
-			 1.0f,  1.0f,  1.0f,  0.0f,  1.0f,  0.0f, 1.0f, 0.0f, // bottom-right
-			-1.0f,  1.0f, -1.0f,  0.0f,  1.0f,  0.0f, 0.0f, 1.0f, // top-left
-			-1.0f,  1.0f,  1.0f,  0.0f,  1.0f,  0.0f, 0.0f, 0.0f  // bottom-left        
-		};
-		glGenVertexArrays(1, &cubeVAO);
-		glGenBuffers(1, &cubeVBO);
-		// fill buffer
-		glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-		// link vertex attributes
-		glBindVertexArray(cubeVAO);
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-		glEnableVertexAttribArray(1);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-		glEnableVertexAttribArray(2);
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		glBindVertexArray(0);
-	}
-	// render Cube
-	glBindVertexArray(cubeVAO);
-	glDrawArrays(GL_TRIANGLES, 0, 36);
-	glBindVertexArray(0);
+	const int sphereCounts[] = { 25, 100, 400 };
+	const int lightCounts[] = { 16, 128, 512 };
+
+	std::vector<ShadingBenchmarkCase> cases;
+	for (int spheres = 0; spheres < 3; ++spheres)
+	{
+		for (int lights = 0; lights < 3; ++lights)
+		{
+			for (int deferred = 0; deferred < 2; ++deferred)
+			{
+				ShadingBenchmarkCase benchmarkCase = { sphereCounts[spheres], lightCounts[lights], deferred == 1, 0.0, 0 };
+				cases.push_back(benchmarkCase);
+			}
+		}
+	}
+	return cases;
+}
+
+void printShadingBenchmark(const std::vector<ShadingBenchmarkCase>& cases)
+{
+	std::cout << "Forward against deferred shading, average frame time" << std::endl;
+	std::cout << "  spheres  lights      forward     deferred" << std::endl;
+	for (std::size_t i = 0; i + 1 < cases.size(); i += 2)
+	{
+		char row[96];
+		snprintf(row, sizeof(row), "  %7d  %6d  %8.2f ms  %8.2f ms", cases[i].spheres, cases[i].lights + 1,
+			cases[i].totalMs / std::max(1, cases[i].frames), cases[i + 1].totalMs / std::max(1, cases[i + 1].frames));
+		std::cout << row << std::endl;
+	}
+}
+
+// startup time of the serial loader against the streamer for all five sets, each timed until the GPU has every map.
+// the two are alternated a few times and the best run of each is kept so the file cache doesn't favour either
+void benchmarkTextureLoading()
+{
+	const int runs = 3;
+	double bestSerial = 1e30, bestStreamed = 1e30, bestFirstFrame = 1e30;
+	std::vector<unsigned int> textures;
+
+	for (int run = 0; run < runs; ++run)
+	{
+		// serial: decode and upload each map in turn on this thread
+		glFinish();
+		double start = glfwGetTime();
+		for (int set = 0; set < 5; ++set)
+		{
+			for (int map = 0; map < 5; ++map)
+			{
+				textures.push_back(loadTexture(textureMapPath(textureSetNames[set], textureMapNames[map]).c_str()));
+			}
+		}
+		glFinish();
+		bestSerial = std::min(bestSerial, glfwGetTime() - start);
+
+		glDeleteTextures((GLsizei)textures.size(), &textures[0]);
+		textures.clear();
+
+		// streamed: request everything, then wait for the workers and the uploads to drain
+		glFinish();
+		start = glfwGetTime();
+		{
+			TextureStreamer streamer;
+			for (int set = 0; set < 5; ++set)
+			{
+				for (int map = 0; map < 5; ++map)
+				{
+					textures.push_back(streamer.request(textureMapPath(textureSetNames[set], textureMapNames[map]), texturePlaceholders[map]));
+				}
+			}
+			bestFirstFrame = std::min(bestFirstFrame, glfwGetTime() - start);	// the demo could start drawing here
+
+			streamer.finish();
+			glFinish();
+		}
+		bestStreamed = std::min(bestStreamed, glfwGetTime() - start);
+
+		glDeleteTextures((GLsizei)textures.size(), &textures[0]);
+		textures.clear();
+	}
+
+	std::cout << "Texture loading, best of " << runs << " runs (cobble, space, rusted, granite, wood)" << std::endl;
+	std::cout << "  serial:   " << bestSerial * 1000.0 << " ms" << std::endl;
+	std::cout << "  streamed: " << bestStreamed * 1000.0 << " ms (first frame after " << bestFirstFrame * 1000.0 << " ms)" << std::endl;
+	std::cout << "  speedup:  " << bestSerial / bestStreamed << "x" << std::endl;
 }
\ No newline at end of file
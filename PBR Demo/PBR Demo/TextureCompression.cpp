@@ -0,0 +1,624 @@
+#include "TextureCompression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+
+// BIT PACKING
+//============
+// BC7 fields are packed least significant bit first across the whole 128 bit block
+struct BlockWriter
+{
+	unsigned char* block;
+	int position;
+
+	void write(unsigned int value, int bits)
+	{
+		for (int i = 0; i < bits; ++i, ++position)
+		{
+			if ((value >> i) & 1)
+			{
+				block[position >> 3] |= (unsigned char)(1 << (position & 7));
+			}
+		}
+	}
+};
+
+struct BlockReader
+{
+	const unsigned char* block;
+	int position;
+
+	unsigned int read(int bits)
+	{
+		unsigned int value = 0;
+		for (int i = 0; i < bits; ++i, ++position)
+		{
+			value |= ((block[position >> 3] >> (position & 7)) & 1u) << i;
+		}
+		return value;
+	}
+};
+
+
+
+// BC7 MODE 6
+//===========
+static const int bc7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+struct BC7Endpoints
+{
+	int colour[2][4];	// 7 bits per channel
+	int pBit[2];
+};
+
+static int bc7Interpolate(int e0, int e1, int index)
+{
+	return ((64 - bc7Weights4[index]) * e0 + bc7Weights4[index] * e1 + 32) >> 6;
+}
+
+// quantize float endpoints to 7 bits plus the given p-bits
+static BC7Endpoints quantizeBC7(const float endpoints[2][4], int p0, int p1)
+{
+	BC7Endpoints quantized;
+	quantized.pBit[0] = p0;
+	quantized.pBit[1] = p1;
+	for (int e = 0; e < 2; ++e)
+	{
+		for (int c = 0; c < 4; ++c)
+		{
+			int value = (int)((endpoints[e][c] - quantized.pBit[e]) * 0.5f + 0.5f);
+			quantized.colour[e][c] = std::min(std::max(value, 0), 127);
+		}
+	}
+	return quantized;
+}
+
+// pick the closest palette entry for every pixel, returns the total squared error
+static int assignBC7Indices(const unsigned char rgba[64], const BC7Endpoints& endpoints, int indices[16])
+{
+	int palette[16][4];
+	for (int c = 0; c < 4; ++c)
+	{
+		int e0 = (endpoints.colour[0][c] << 1) | endpoints.pBit[0];
+		int e1 = (endpoints.colour[1][c] << 1) | endpoints.pBit[1];
+		for (int i = 0; i < 16; ++i)
+		{
+			palette[i][c] = bc7Interpolate(e0, e1, i);
+		}
+	}
+
+	int totalError = 0;
+	for (int pixel = 0; pixel < 16; ++pixel)
+	{
+		int bestError = 0x7fffffff;
+		for (int i = 0; i < 16; ++i)
+		{
+			int error = 0;
+			for (int c = 0; c < 4; ++c)
+			{
+				int difference = palette[i][c] - rgba[pixel * 4 + c];
+				error += difference * difference;
+			}
+			if (error < bestError)
+			{
+				bestError = error;
+				indices[pixel] = i;
+			}
+		}
+		totalError += bestError;
+	}
+	return totalError;
+}
+
+// try every p-bit combination for a pair of float endpoints, keeps the best in bestEndpoints/bestIndices
+static void fitBC7(const unsigned char rgba[64], const float endpoints[2][4], int& bestError, BC7Endpoints& bestEndpoints, int bestIndices[16])
+{
+	for (int p = 0; p < 4; ++p)
+	{
+		BC7Endpoints quantized = quantizeBC7(endpoints, p & 1, p >> 1);
+		int indices[16];
+		int error = assignBC7Indices(rgba, quantized, indices);
+		if (error < bestError)
+		{
+			bestError = error;
+			bestEndpoints = quantized;
+			memcpy(bestIndices, indices, sizeof(indices));
+		}
+	}
+}
+
+void encodeBC7Block(const unsigned char rgba[16 * 4], unsigned char block[16])
+{
+	// endpoints along the principal axis of the block's colours
+	float mean[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	for (int pixel = 0; pixel < 16; ++pixel)
+	{
+		for (int c = 0; c < 4; ++c)
+		{
+			mean[c] += rgba[pixel * 4 + c] / 16.0f;
+		}
+	}
+
+	float covariance[4][4] = {};
+	for (int pixel = 0; pixel < 16; ++pixel)
+	{
+		float d[4];
+		for (int c = 0; c < 4; ++c)
+		{
+			d[c] = rgba[pixel * 4 + c] - mean[c];
+		}
+		for (int i = 0; i < 4; ++i)
+		{
+			for (int j = 0; j < 4; ++j)
+			{
+				covariance[i][j] += d[i] * d[j];
+			}
+		}
+	}
+
+	float axis[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	for (int iteration = 0; iteration < 8; ++iteration)	// power iteration
+	{
+		float next[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		float length = 0.0f;
+		for (int i = 0; i < 4; ++i)
+		{
+			for (int j = 0; j < 4; ++j)
+			{
+				next[i] += covariance[i][j] * axis[j];
+			}
+			length += next[i] * next[i];
+		}
+		if (length < 1e-8f)
+		{
+			break;	// flat block, any axis will do
+		}
+		length = 1.0f / sqrtf(length);
+		for (int i = 0; i < 4; ++i)
+		{
+			axis[i] = next[i] * length;
+		}
+	}
+
+	float minT = 0.0f, maxT = 0.0f;
+	for (int pixel = 0; pixel < 16; ++pixel)
+	{
+		float t = 0.0f;
+		for (int c = 0; c < 4; ++c)
+		{
+			t += (rgba[pixel * 4 + c] - mean[c]) * axis[c];
+		}
+		minT = std::min(minT, t);
+		maxT = std::max(maxT, t);
+	}
+
+	float endpoints[2][4];
+	for (int c = 0; c < 4; ++c)
+	{
+		endpoints[0][c] = std::min(std::max(mean[c] + axis[c] * minT, 0.0f), 255.0f);
+		endpoints[1][c] = std::min(std::max(mean[c] + axis[c] * maxT, 0.0f), 255.0f);
+	}
+
+	int bestError = 0x7fffffff;
+	BC7Endpoints best;
+	int indices[16];
+	fitBC7(rgba, endpoints, bestError, best, indices);
+
+	// one least squares refinement of the endpoints for the chosen indices
+	float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+	float ax[4] = { 0.0f, 0.0f, 0.0f, 0.0f }, bx[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	for (int pixel = 0; pixel < 16; ++pixel)
+	{
+		float w = bc7Weights4[indices[pixel]] / 64.0f;
+		aa += (1.0f - w) * (1.0f - w);
+		ab += (1.0f - w) * w;
+		bb += w * w;
+		for (int c = 0; c < 4; ++c)
+		{
+			ax[c] += (1.0f - w) * rgba[pixel * 4 + c];
+			bx[c] += w * rgba[pixel * 4 + c];
+		}
+	}
+	float determinant = aa * bb - ab * ab;
+	if (fabsf(determinant) > 1e-6f)
+	{
+		float refined[2][4];
+		for (int c = 0; c < 4; ++c)
+		{
+			refined[0][c] = std::min(std::max((bb * ax[c] - ab * bx[c]) / determinant, 0.0f), 255.0f);
+			refined[1][c] = std::min(std::max((aa * bx[c] - ab * ax[c]) / determinant, 0.0f), 255.0f);
+		}
+		fitBC7(rgba, refined, bestError, best, indices);
+	}
+
+	// the first pixel's index is stored with its top bit implied zero, swap the endpoints if it isn't
+	if (indices[0] & 8)
+	{
+		for (int c = 0; c < 4; ++c)
+		{
+			std::swap(best.colour[0][c], best.colour[1][c]);
+		}
+		std::swap(best.pBit[0], best.pBit[1]);
+		for (int pixel = 0; pixel < 16; ++pixel)
+		{
+			indices[pixel] = 15 - indices[pixel];
+		}
+	}
+
+	memset(block, 0, 16);
+	BlockWriter writer = { block, 0 };
+	writer.write(1 << 6, 7);	// mode 6
+	for (int c = 0; c < 4; ++c)
+	{
+		writer.write(best.colour[0][c], 7);
+		writer.write(best.colour[1][c], 7);
+	}
+	writer.write(best.pBit[0], 1);
+	writer.write(best.pBit[1], 1);
+	writer.write(indices[0], 3);
+	for (int pixel = 1; pixel < 16; ++pixel)
+	{
+		writer.write(indices[pixel], 4);
+	}
+}
+
+void decodeBC7Block(const unsigned char block[16], unsigned char rgba[16 * 4])
+{
+	if ((block[0] & 0x7f) != (1 << 6))
+	{
+		for (int pixel = 0; pixel < 16; ++pixel)
+		{
+			rgba[pixel * 4 + 0] = 255;
+			rgba[pixel * 4 + 1] = 0;
+			rgba[pixel * 4 + 2] = 255;
+			rgba[pixel * 4 + 3] = 255;
+		}
+		return;
+	}
+
+	BlockReader reader = { block, 7 };
+	int colour[2][4];
+	for (int c = 0; c < 4; ++c)
+	{
+		colour[0][c] = reader.read(7);
+		colour[1][c] = reader.read(7);
+	}
+	int p0 = reader.read(1);
+	int p1 = reader.read(1);
+	for (int c = 0; c < 4; ++c)
+	{
+		colour[0][c] = (colour[0][c] << 1) | p0;
+		colour[1][c] = (colour[1][c] << 1) | p1;
+	}
+
+	for (int pixel = 0; pixel < 16; ++pixel)
+	{
+		int index = reader.read(pixel == 0 ? 3 : 4);
+		for (int c = 0; c < 4; ++c)
+		{
+			rgba[pixel * 4 + c] = (unsigned char)bc7Interpolate(colour[0][c], colour[1][c], index);
+		}
+	}
+}
+
+
+
+// BC5
+//====
+// two BC4 blocks, red then green. always written in 8 value mode (first endpoint larger)
+static void bc4Palette(int e0, int e1, int palette[8])
+{
+	palette[0] = e0;
+	palette[1] = e1;
+	if (e0 > e1)
+	{
+		for (int i = 2; i < 8; ++i)
+		{
+			palette[i] = ((8 - i) * e0 + (i - 1) * e1 + 3) / 7;
+		}
+	}
+	else
+	{
+		for (int i = 2; i < 6; ++i)
+		{
+			palette[i] = ((6 - i) * e0 + (i - 1) * e1 + 2) / 5;
+		}
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+}
+
+static void encodeBC4Block(const unsigned char rgba[64], int channel, unsigned char block[8])
+{
+	int minimum = 255, maximum = 0;
+	for (int pixel = 0; pixel < 16; ++pixel)
+	{
+		minimum = std::min(minimum, (int)rgba[pixel * 4 + channel]);
+		maximum = std::max(maximum, (int)rgba[pixel * 4 + channel]);
+	}
+
+	int palette[8];
+	bc4Palette(maximum, minimum, palette);
+
+	std::uint64_t bits = 0;
+	for (int pixel = 0; pixel < 16; ++pixel)
+	{
+		int value = rgba[pixel * 4 + channel];
+		int bestIndex = 0, bestError = 256;
+		for (int i = 0; i < 8; ++i)
+		{
+			int error = abs(palette[i] - value);
+			if (error < bestError)
+			{
+				bestError = error;
+				bestIndex = i;
+			}
+		}
+		bits |= (std::uint64_t)bestIndex << (pixel * 3);
+	}
+
+	block[0] = (unsigned char)maximum;
+	block[1] = (unsigned char)minimum;
+	for (int i = 0; i < 6; ++i)
+	{
+		block[2 + i] = (unsigned char)(bits >> (i * 8));
+	}
+}
+
+static void decodeBC4Block(const unsigned char block[8], int channel, unsigned char rgba[64])
+{
+	int palette[8];
+	bc4Palette(block[0], block[1], palette);
+
+	std::uint64_t bits = 0;
+	for (int i = 0; i < 6; ++i)
+	{
+		bits |= (std::uint64_t)block[2 + i] << (i * 8);
+	}
+	for (int pixel = 0; pixel < 16; ++pixel)
+	{
+		rgba[pixel * 4 + channel] = (unsigned char)palette[(bits >> (pixel * 3)) & 7];
+	}
+}
+
+void encodeBC5Block(const unsigned char rgba[16 * 4], unsigned char block[16])
+{
+	encodeBC4Block(rgba, 0, block);
+	encodeBC4Block(rgba, 1, block + 8);
+}
+
+void decodeBC5Block(const unsigned char block[16], unsigned char rgba[16 * 4])
+{
+	decodeBC4Block(block, 0, rgba);
+	decodeBC4Block(block + 8, 1, rgba);
+	for (int pixel = 0; pixel < 16; ++pixel)
+	{
+		rgba[pixel * 4 + 2] = 0;
+		rgba[pixel * 4 + 3] = 255;
+	}
+}
+
+
+
+// IMAGES
+//=======
+std::size_t compressedSize(int width, int height)
+{
+	return (std::size_t)((width + 3) / 4) * ((height + 3) / 4) * compressedBlockSize;
+}
+
+// one row of blocks at a time, rows are shared out between threads
+static void compressRows(BlockFormat format, const unsigned char* rgba, int width, int height, unsigned char* blocks, int firstRow, int rowStep)
+{
+	int blocksWide = (width + 3) / 4;
+	int blocksHigh = (height + 3) / 4;
+	unsigned char pixels[16 * 4];
+	for (int by = firstRow; by < blocksHigh; by += rowStep)
+	{
+		for (int bx = 0; bx < blocksWide; ++bx)
+		{
+			for (int y = 0; y < 4; ++y)
+			{
+				for (int x = 0; x < 4; ++x)
+				{
+					int sx = std::min(bx * 4 + x, width - 1);
+					int sy = std::min(by * 4 + y, height - 1);
+					memcpy(&pixels[(y * 4 + x) * 4], &rgba[((std::size_t)sy * width + sx) * 4], 4);
+				}
+			}
+
+			unsigned char* block = blocks + ((std::size_t)by * blocksWide + bx) * compressedBlockSize;
+			if (format == BLOCK_FORMAT_BC7)
+			{
+				encodeBC7Block(pixels, block);
+			}
+			else
+			{
+				encodeBC5Block(pixels, block);
+			}
+		}
+	}
+}
+
+void compressImage(BlockFormat format, const unsigned char* rgba, int width, int height, unsigned char* blocks)
+{
+	int threadCount = std::max(1u, std::thread::hardware_concurrency());
+	std::vector<std::thread> threads;
+	for (int i = 1; i < threadCount; ++i)
+	{
+		threads.push_back(std::thread(compressRows, format, rgba, width, height, blocks, i, threadCount));
+	}
+	compressRows(format, rgba, width, height, blocks, 0, threadCount);
+	for (std::size_t i = 0; i < threads.size(); ++i)
+	{
+		threads[i].join();
+	}
+}
+
+void decompressImage(BlockFormat format, const unsigned char* blocks, int width, int height, unsigned char* rgba)
+{
+	int blocksWide = (width + 3) / 4;
+	int blocksHigh = (height + 3) / 4;
+	unsigned char pixels[16 * 4];
+	for (int by = 0; by < blocksHigh; ++by)
+	{
+		for (int bx = 0; bx < blocksWide; ++bx)
+		{
+			const unsigned char* block = blocks + ((std::size_t)by * blocksWide + bx) * compressedBlockSize;
+			if (format == BLOCK_FORMAT_BC7)
+			{
+				decodeBC7Block(block, pixels);
+			}
+			else
+			{
+				decodeBC5Block(block, pixels);
+			}
+
+			// drop the padding of edge blocks
+			for (int y = 0; y < 4 && by * 4 + y < height; ++y)
+			{
+				for (int x = 0; x < 4 && bx * 4 + x < width; ++x)
+				{
+					memcpy(&rgba[((std::size_t)(by * 4 + y) * width + bx * 4 + x) * 4], &pixels[(y * 4 + x) * 4], 4);
+				}
+			}
+		}
+	}
+}
+
+
+
+// DDS
+//====
+struct DDSPixelFormat
+{
+	std::uint32_t size;
+	std::uint32_t flags;
+	std::uint32_t fourCC;
+	std::uint32_t rgbBitCount;
+	std::uint32_t bitMasks[4];
+};
+
+struct DDSHeader
+{
+	std::uint32_t size;
+	std::uint32_t flags;
+	std::uint32_t height;
+	std::uint32_t width;
+	std::uint32_t pitchOrLinearSize;
+	std::uint32_t depth;
+	std::uint32_t mipMapCount;
+	std::uint32_t reserved1[11];
+	DDSPixelFormat pixelFormat;
+	std::uint32_t caps[4];
+	std::uint32_t reserved2;
+};
+
+struct DDSHeaderDX10
+{
+	std::uint32_t dxgiFormat;
+	std::uint32_t resourceDimension;
+	std::uint32_t miscFlag;
+	std::uint32_t arraySize;
+	std::uint32_t miscFlags2;
+};
+
+static const std::uint32_t ddsMagic = 0x20534444;		// "DDS "
+static const std::uint32_t ddsFourCCDX10 = 0x30315844;	// "DX10"
+static const std::uint32_t dxgiFormatBC5 = 83;			// DXGI_FORMAT_BC5_UNORM
+static const std::uint32_t dxgiFormatBC7 = 98;			// DXGI_FORMAT_BC7_UNORM
+static const std::uint32_t dxgiFormatBC7sRGB = 99;		// DXGI_FORMAT_BC7_UNORM_SRGB, read as linear like the PNGs
+
+bool writeDDS(const std::string& path, const CompressedImage& image)
+{
+	DDSHeader header;
+	memset(&header, 0, sizeof(header));
+	header.size = sizeof(DDSHeader);
+	header.flags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000;	// caps, height, width, pixel format, mip count, linear size
+	header.height = image.height;
+	header.width = image.width;
+	header.pitchOrLinearSize = (std::uint32_t)compressedSize(image.width, image.height);
+	header.mipMapCount = (std::uint32_t)image.levels.size();
+	header.pixelFormat.size = sizeof(DDSPixelFormat);
+	header.pixelFormat.flags = 0x4;	// fourCC
+	header.pixelFormat.fourCC = ddsFourCCDX10;
+	header.caps[0] = 0x1000 | 0x400000 | 0x8;	// texture, mipmap, complex
+
+	DDSHeaderDX10 extension;
+	extension.dxgiFormat = image.format == BLOCK_FORMAT_BC7 ? dxgiFormatBC7 : dxgiFormatBC5;
+	extension.resourceDimension = 3;	// 2D
+	extension.miscFlag = 0;
+	extension.arraySize = 1;
+	extension.miscFlags2 = 0;
+
+	std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+	file.write((const char*)&ddsMagic, sizeof(ddsMagic));
+	file.write((const char*)&header, sizeof(header));
+	file.write((const char*)&extension, sizeof(extension));
+	for (std::size_t i = 0; i < image.levels.size(); ++i)
+	{
+		file.write((const char*)&image.levels[i][0], image.levels[i].size());
+	}
+	return file.good();
+}
+
+bool parseDDS(const unsigned char* data, std::size_t size, CompressedImageView& view)
+{
+	std::size_t headerSize = sizeof(ddsMagic) + sizeof(DDSHeader) + sizeof(DDSHeaderDX10);
+	if (size < headerSize)
+	{
+		return false;
+	}
+
+	std::uint32_t magic;
+	DDSHeader header;
+	DDSHeaderDX10 extension;
+	memcpy(&magic, data, sizeof(magic));
+	memcpy(&header, data + sizeof(magic), sizeof(header));
+	memcpy(&extension, data + sizeof(magic) + sizeof(header), sizeof(extension));
+	if (magic != ddsMagic || header.size != sizeof(DDSHeader) || header.pixelFormat.fourCC != ddsFourCCDX10 || extension.resourceDimension != 3 || extension.arraySize != 1)
+	{
+		return false;
+	}
+
+	if (extension.dxgiFormat == dxgiFormatBC7 || extension.dxgiFormat == dxgiFormatBC7sRGB)
+	{
+		view.format = BLOCK_FORMAT_BC7;
+	}
+	else if (extension.dxgiFormat == dxgiFormatBC5)
+	{
+		view.format = BLOCK_FORMAT_BC5;
+	}
+	else
+	{
+		return false;
+	}
+
+	view.width = header.width;
+	view.height = header.height;
+	view.levelCount = std::max(1, (int)header.mipMapCount);
+	if (view.width <= 0 || view.height <= 0 || view.levelCount > maxCompressedLevels)
+	{
+		return false;
+	}
+
+	std::size_t offset = headerSize;
+	for (int level = 0; level < view.levelCount; ++level)
+	{
+		std::size_t levelSize = compressedSize(std::max(1, view.width >> level), std::max(1, view.height >> level));
+		if (levelSize > size - offset)
+		{
+			return false;	// truncated
+		}
+		view.levels[level] = data + offset;
+		view.levelSizes[level] = levelSize;
+		offset += levelSize;
+	}
+	return true;
+}
@@ -0,0 +1,63 @@
+#ifndef TEXTURECOMPRESSION_H
+#define TEXTURECOMPRESSION_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+
+// BLOCK COMPRESSION
+//==================
+// CPU side of BC5 and BC7, no GL in here: the encoders are used by the offline TextureTool and the
+// decoders by the demo when the driver can't sample BPTC. Only BC7 mode 6 (one subset, RGBA endpoints,
+// 4 bit indices) is written or read. It is what TextureTool produces and suits smooth albedo and
+// packed ORM data well; blocks in any other mode decode to magenta.
+
+enum BlockFormat
+{
+	BLOCK_FORMAT_BC5,	// two channel, normal maps
+	BLOCK_FORMAT_BC7	// four channel
+};
+
+const int compressedBlockSize = 16;		// bytes per 4x4 block, both formats
+
+void encodeBC7Block(const unsigned char rgba[16 * 4], unsigned char block[16]);
+void decodeBC7Block(const unsigned char block[16], unsigned char rgba[16 * 4]);
+void encodeBC5Block(const unsigned char rgba[16 * 4], unsigned char block[16]);	// from .r and .g
+void decodeBC5Block(const unsigned char block[16], unsigned char rgba[16 * 4]);	// into .r and .g, b = 0 and a = 255 like GL samples it
+
+std::size_t compressedSize(int width, int height);		// bytes in one mip
+
+// whole images, edge blocks of sizes that aren't a multiple of 4 repeat the last row/column.
+// compression is split across one thread per core
+void compressImage(BlockFormat format, const unsigned char* rgba, int width, int height, unsigned char* blocks);
+void decompressImage(BlockFormat format, const unsigned char* blocks, int width, int height, unsigned char* rgba);
+
+
+// DDS CONTAINER
+//==============
+// DX10 extended header, a single 2D texture with its full mip chain stored largest first
+
+const int maxCompressedLevels = 16;
+
+// owns its mips, what TextureTool builds and writes
+struct CompressedImage
+{
+	BlockFormat format;
+	int width, height;
+	std::vector<std::vector<unsigned char> > levels;
+};
+
+// points into a loaded or memory mapped file, what the demo uploads from
+struct CompressedImageView
+{
+	BlockFormat format;
+	int width, height;
+	int levelCount;
+	const unsigned char* levels[maxCompressedLevels];
+	std::size_t levelSizes[maxCompressedLevels];
+};
+
+bool writeDDS(const std::string& path, const CompressedImage& image);
+bool parseDDS(const unsigned char* data, std::size_t size, CompressedImageView& view);	// false if not a BC5/BC7 DDS we can read
+#endif
@@ -0,0 +1,333 @@
+#include "TextureStreamer.h"
+#include "GLCaps.h"
+
+#include <stb_image.h>
+
+#include <cstring>
+#include <iostream>
+
+
+//CONSTRUCTOR
+//============
+TextureStreamer::TextureStreamer(unsigned int workerCount, size_t stagingSegmentSize)
+	: stopping(false), pending(0), pbo(0), mapped(NULL), segmentSize(stagingSegmentSize), segment(0)
+{
+	for (int i = 0; i < segmentCount; ++i)
+	{
+		segmentFences[i] = 0;
+	}
+
+	// staging buffer: persistently mapped when the driver allows it, otherwise orphaned and remapped per update
+	glGenBuffers(1, &pbo);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+	if (glCaps.bufferStorage)
+	{
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_PIXEL_UNPACK_BUFFER, segmentSize * segmentCount, NULL, flags);
+		mapped = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, segmentSize * segmentCount, flags);
+	}
+	else
+	{
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, segmentSize, NULL, GL_STREAM_DRAW);
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	// decoding threads
+	if (workerCount == 0)
+	{
+		workerCount = std::thread::hardware_concurrency();
+		if (workerCount == 0)
+		{
+			workerCount = 1;
+		}
+	}
+	for (unsigned int i = 0; i < workerCount; ++i)
+	{
+		workers.push_back(std::thread(&TextureStreamer::workerLoop, this));
+	}
+}
+
+// the textures outlive the streamer, the staging buffer and its fences don't
+TextureStreamer::~TextureStreamer()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	jobAvailable.notify_all();
+	for (std::size_t i = 0; i < workers.size(); ++i)
+	{
+		workers[i].join();
+	}
+
+	for (std::size_t i = 0; i < decoded.size(); ++i)
+	{
+		stbi_image_free(decoded[i].pixels);
+	}
+
+	for (int i = 0; i < segmentCount; ++i)
+	{
+		if (segmentFences[i])
+		{
+			glDeleteSync(segmentFences[i]);
+		}
+	}
+	if (mapped)
+	{
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+	glDeleteBuffers(1, &pbo);
+}
+
+
+
+// FUNCTIONS
+//==========
+unsigned int TextureStreamer::request(const std::string& path, const glm::vec4& placeholder)
+{
+	unsigned int textureID;
+	glGenTextures(1, &textureID);
+
+	unsigned char texel[4] =
+	{
+		(unsigned char)(placeholder.r * 255.0f),
+		(unsigned char)(placeholder.g * 255.0f),
+		(unsigned char)(placeholder.b * 255.0f),
+		(unsigned char)(placeholder.a * 255.0f)
+	};
+	glBindTexture(GL_TEXTURE_2D, textureID);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, texel);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.push_back({ textureID, path });
+	}
+	jobAvailable.notify_one();
+	++pending;
+	requested[path] = textureID;
+
+	return textureID;
+}
+
+// the old image stays bound until the new one is uploaded over it
+bool TextureStreamer::reload(const std::string& path)
+{
+	std::unordered_map<std::string, unsigned int>::const_iterator found = requested.find(path);
+	if (found == requested.end())
+	{
+		return false;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.push_back({ found->second, path });
+	}
+	jobAvailable.notify_one();
+	++pending;
+	return true;
+}
+
+int TextureStreamer::update(std::vector<unsigned int>* uploaded)
+{
+	if (pending == 0)
+	{
+		return 0;
+	}
+
+	// the GPU may still be reading this segment from a few frames ago; skip the frame rather than stall on it
+	if (segmentFences[segment])
+	{
+		if (glClientWaitSync(segmentFences[segment], GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED)
+		{
+			return 0;
+		}
+		glDeleteSync(segmentFences[segment]);
+		segmentFences[segment] = 0;
+	}
+
+	// take as many decoded images as fit in one segment. anything bigger than a whole segment
+	// is uploaded straight from client memory instead
+	std::vector<DecodedImage> batch;
+	std::vector<size_t> offsets;
+	size_t used = 0;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		while (!decoded.empty())
+		{
+			const DecodedImage& image = decoded.front();
+			size_t size = image.pixels ? (size_t)image.width * image.height * image.components : 0;
+			bool staged = size > 0 && size <= segmentSize;
+			if (staged && used + size > segmentSize)
+			{
+				break;
+			}
+
+			batch.push_back(image);
+			offsets.push_back(staged ? used : (size_t)-1);
+			decoded.pop_front();
+			if (staged)
+			{
+				used += size;
+			}
+		}
+	}
+	if (batch.empty())
+	{
+		return 0;
+	}
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+	size_t segmentBase = 0;
+	if (used > 0)
+	{
+		unsigned char* staging;
+		if (mapped)
+		{
+			segmentBase = segment * segmentSize;
+			staging = mapped + segmentBase;
+		}
+		else
+		{
+			glBufferData(GL_PIXEL_UNPACK_BUFFER, segmentSize, NULL, GL_STREAM_DRAW);	// orphan last frame's storage
+			staging = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, used, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		}
+
+		for (std::size_t i = 0; i < batch.size(); ++i)
+		{
+			if (offsets[i] != (size_t)-1)
+			{
+				memcpy(staging + offsets[i], batch[i].pixels, (size_t)batch[i].width * batch[i].height * batch[i].components);
+			}
+		}
+
+		if (!mapped)
+		{
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		}
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);	// single channel maps are rarely a multiple of 4 bytes wide
+	for (std::size_t i = 0; i < batch.size(); ++i)
+	{
+		if (!batch[i].pixels)
+		{
+			std::cout << "Texture failed to load at path: " << batch[i].path << std::endl;	// keeps its placeholder
+			continue;
+		}
+		if (uploaded)
+		{
+			uploaded->push_back(batch[i].texture);
+		}
+
+		if (offsets[i] == (size_t)-1)
+		{
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			upload(batch[i], batch[i].pixels);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+		}
+		else
+		{
+			upload(batch[i], (const void*)(segmentBase + offsets[i]));	// offset into the bound unpack buffer
+		}
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	if (mapped && used > 0)
+	{
+		segmentFences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		segment = (segment + 1) % segmentCount;
+	}
+
+	for (std::size_t i = 0; i < batch.size(); ++i)
+	{
+		stbi_image_free(batch[i].pixels);
+	}
+	pending -= (int)batch.size();
+
+	return (int)batch.size();
+}
+
+void TextureStreamer::finish(std::vector<unsigned int>* uploaded)
+{
+	while (pending > 0)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			imageDecoded.wait(lock, [this] { return !decoded.empty(); });
+		}
+
+		// block on the next segment's fence so update() can't skip
+		if (segmentFences[segment])
+		{
+			glClientWaitSync(segmentFences[segment], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+		}
+		update(uploaded);
+	}
+}
+
+bool TextureStreamer::isIdle() const
+{
+	return pending == 0;
+}
+
+// decode jobs until the streamer is destroyed
+void TextureStreamer::workerLoop()
+{
+	stbi_set_flip_vertically_on_load_thread(0);	// the HDR loader flips on the main thread, material maps never were
+
+	for (;;)
+	{
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			jobAvailable.wait(lock, [this] { return stopping || !jobs.empty(); });
+			if (stopping)
+			{
+				return;
+			}
+			job = jobs.front();
+			jobs.pop_front();
+		}
+
+		DecodedImage image;
+		image.texture = job.texture;
+		image.path = job.path;
+		image.pixels = stbi_load(job.path.c_str(), &image.width, &image.height, &image.components, 0);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			decoded.push_back(image);
+		}
+		imageDecoded.notify_all();
+	}
+}
+
+// replace the placeholder with the decoded image, pixels is a client pointer or an unpack buffer offset
+void TextureStreamer::upload(const DecodedImage& image, const void* pixels)
+{
+	GLenum format = GL_RGBA;
+	if (image.components == 1)
+	{
+		format = GL_RED;
+	}
+	else if (image.components == 2)
+	{
+		format = GL_RG;
+	}
+	else if (image.components == 3)
+	{
+		format = GL_RGB;
+	}
+
+	glBindTexture(GL_TEXTURE_2D, image.texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, pixels);
+	glGenerateMipmap(GL_TEXTURE_2D);
+}
@@ -0,0 +1,72 @@
+#ifndef TEXTURESTREAMER_H
+#define TEXTURESTREAMER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+
+// Decodes images on worker threads and uploads them on the GL thread through a pixel unpack buffer.
+// request() hands back a texture straight away which holds a 1x1 placeholder colour until update()
+// has uploaded the real image into it, so callers can bind it immediately and never see it change name.
+class TextureStreamer
+{
+public:
+	TextureStreamer(unsigned int workerCount = 0, size_t stagingSegmentSize = 16 * 1024 * 1024);	// 0 workers = one per core
+	~TextureStreamer();
+
+	unsigned int request(const std::string& path, const glm::vec4& placeholder);	// queue an image, returns its texture ID
+	bool reload(const std::string& path);		// decode a requested image again into the same texture, false if it was never requested
+
+	// upload finished decodes, call once per frame on the GL thread. returns textures uploaded, which are
+	// also appended to uploaded when it isn't NULL
+	int update(std::vector<unsigned int>* uploaded = NULL);
+	void finish(std::vector<unsigned int>* uploaded = NULL);	// block until every request made so far has been uploaded
+	bool isIdle() const;		// true when nothing is queued, decoding or waiting for upload
+
+private:
+	struct Job
+	{
+		unsigned int texture;
+		std::string path;
+	};
+	struct DecodedImage
+	{
+		unsigned int texture;
+		std::string path;
+		unsigned char* pixels;	// stb_image allocation, NULL if decoding failed
+		int width, height, components;
+	};
+
+	void workerLoop();
+	void upload(const DecodedImage& image, const void* pixels);
+
+	// worker side
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable jobAvailable;	// wakes workers
+	std::condition_variable imageDecoded;	// wakes finish()
+	std::deque<Job> jobs;
+	std::deque<DecodedImage> decoded;
+	bool stopping;
+
+	// GL thread side
+	int pending;				// requests not uploaded yet
+	std::unordered_map<std::string, unsigned int> requested;	// path -> texture, for reload()
+
+	// staging memory: segmentCount equal slices of one buffer, each update() fills one slice and fences it
+	static const int segmentCount = 3;
+	unsigned int pbo;
+	unsigned char* mapped;		// persistent mapping, NULL when buffer storage is unavailable
+	size_t segmentSize;
+	int segment;
+	GLsync segmentFences[segmentCount];
+};
+#endif
@@ -0,0 +1,50 @@
+#version 400 core
+// integrates the specular BRDF for the split sum approximation:
+// x = NdotV, y = roughness, output = scale and bias applied to F0
+out vec2 FragColor;
+in vec2 TexCoords;
+
+uniform int sampleCount;    // importance samples per texel
+
+#include "inc_ImportanceSampling.glsl"
+
+// Schlick-GGX with k for image based lighting
+float GeometrySchlickGGX(float NdotV, float roughness)
+{
+    float k = (roughness * roughness) / 2.0;
+    return NdotV / (NdotV * (1.0 - k) + k);
+}
+
+void main()
+{
+    float NdotV = max(TexCoords.x, 0.0001);
+    float roughness = TexCoords.y;
+
+    vec3 V = vec3(sqrt(1.0 - NdotV * NdotV), 0.0, NdotV);
+    vec3 N = vec3(0.0, 0.0, 1.0);
+
+    float A = 0.0;
+    float B = 0.0;
+    for(uint i = 0u; i < uint(sampleCount); ++i)
+    {
+        vec2 Xi = Hammersley(i, uint(sampleCount));
+        vec3 H = ImportanceSampleGGX(Xi, N, roughness);
+        vec3 L = normalize(2.0 * dot(V, H) * H - V);
+
+        float NdotL = max(L.z, 0.0);
+        float NdotH = max(H.z, 0.0);
+        float VdotH = max(dot(V, H), 0.0);
+
+        if(NdotL > 0.0)
+        {
+            float G = GeometrySchlickGGX(NdotV, roughness) * GeometrySchlickGGX(NdotL, roughness);
+            float G_Vis = (G * VdotH) / (NdotH * NdotV);
+            float Fc = pow(1.0 - VdotH, 5.0);
+
+            A += (1.0 - Fc) * G_Vis;
+            B += Fc * G_Vis;
+        }
+    }
+
+    FragColor = vec2(A, B) / float(sampleCount);
+}
@@ -0,0 +1,53 @@
+#version 400 core
+// lighting pass of the deferred path, a full screen quad over the G-buffer written by fs_PBR's GBUFFER variant
+// outputs
+out vec4 FragColor; // final fragment colour
+
+// inputs
+in vec2 TexCoords;  // screen coordinates
+vec3 WorldPos;      // rebuilt from depth
+
+// UNIFORMS (can be changed outside of shaders)
+//==========
+#include "inc_FrameData.glsl"
+
+// G-buffer, see GBuffer.h
+uniform sampler2D gAlbedoAO;
+uniform sampler2D gNormalMaterial;
+uniform sampler2D gDepth;
+
+#include "inc_Lighting.glsl"
+#include "inc_Octahedral.glsl"     // G-buffer normals
+
+void main()
+{      
+    // nothing was drawn here, leave it to the skybox
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(gDepth, pixel, 0).r;
+    if (depth == 1.0)
+    {
+        discard;
+    }
+    gl_FragDepth = depth;
+
+    vec4 position = inverseViewProjection * vec4(vec3(TexCoords, depth) * 2.0 - 1.0, 1.0);
+    WorldPos = position.xyz / position.w;
+
+    // retrieve the material properties from the G-buffer
+    vec4 albedoAO = texelFetch(gAlbedoAO, pixel, 0);
+    vec4 normalMaterial = texelFetch(gNormalMaterial, pixel, 0);
+    vec3 albedo = pow(albedoAO.rgb, vec3(2.2));
+    float ao = albedoAO.a;
+    float roughness = normalMaterial.z;
+    float metallic = normalMaterial.w;
+
+    vec3 normal = OctahedralDecode(normalMaterial.xy * 2.0 - 1.0);
+    vec3 viewDir = normalize(viewPos.xyz - WorldPos);
+
+    vec3 colour = shadeSurface(WorldPos, normal, viewDir, albedo, metallic, roughness, ao);
+
+    colour = colour / (colour + vec3(1.0));     // tone map HDR values to LDR
+    colour = pow(colour, vec3(1.0 / 2.2));      // gamma correction
+
+    FragColor = vec4(colour, 1.0);
+}
\ No newline at end of file
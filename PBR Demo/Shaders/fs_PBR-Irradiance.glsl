@@ -0,0 +1,42 @@
+#version 400 core
+// convolves the environment with a cosine lobe for the diffuse part of image based lighting
+out vec4 FragColor;
+in vec3 WorldPos;
+
+uniform samplerCube environmentMap;
+uniform int sampleCount;    // hemisphere samples per texel
+uniform float resolution;   // environment cubemap face size
+
+#include "inc_ImportanceSampling.glsl"     // Hammersley spreads the samples evenly over the hemisphere
+
+void main()
+{
+    vec3 N = normalize(WorldPos);
+
+    // tangent space basis around the normal
+    vec3 up = abs(N.z) < 0.999 ? vec3(0.0, 0.0, 1.0) : vec3(1.0, 0.0, 0.0);
+    vec3 tangent = normalize(cross(up, N));
+    vec3 bitangent = cross(N, tangent);
+
+    // the cosine weighting lives in the sample distribution, so every sample counts equally
+    float saTexel = 4.0 * PI / (6.0 * resolution * resolution);
+    vec3 irradiance = vec3(0.0);
+    for(uint i = 0u; i < uint(sampleCount); ++i)
+    {
+        vec2 Xi = Hammersley(i, uint(sampleCount));
+        float phi = 2.0 * PI * Xi.x;
+        float cosTheta = sqrt(1.0 - Xi.y);
+        float sinTheta = sqrt(Xi.y);
+        vec3 L = tangent * (cos(phi) * sinTheta) + bitangent * (sin(phi) * sinTheta) + N * cosTheta;
+
+        // read from a blurrier mip where each sample covers more than one texel
+        float pdf = cosTheta / PI;
+        float saSample = 1.0 / (float(sampleCount) * pdf + 0.0001);
+        float mipLevel = 0.5 * log2(saSample / saTexel) + 1.0;
+
+        irradiance += textureLod(environmentMap, L, max(mipLevel, 0.0)).rgb;
+    }
+    irradiance = irradiance / float(sampleCount);
+
+    FragColor = vec4(irradiance, 1.0);
+}
@@ -0,0 +1,12 @@
+#version 400 core
+// copies one single channel map into a channel of a packed material layer,
+// the colour mask set by MaterialLibrary::refresh() picks which channel is written
+out vec4 FragColor;
+in vec2 TexCoords;
+
+uniform sampler2D source;
+
+void main()
+{
+    FragColor = vec4(texture(source, TexCoords).r);
+}
@@ -0,0 +1,54 @@
+#version 400 core
+// convolves the environment with the GGX lobe for one roughness, one mip of the prefiltered specular map
+out vec4 FragColor;
+in vec3 WorldPos;
+
+uniform samplerCube environmentMap;
+uniform float roughness;
+uniform int sampleCount;    // importance samples per texel
+uniform float resolution;   // environment cubemap face size
+
+#include "inc_ImportanceSampling.glsl"
+
+float DistributionGGX(float NdotH, float roughness)
+{
+    float a = roughness * roughness;
+    float a2 = a * a;
+    float denominator = NdotH * NdotH * (a2 - 1.0) + 1.0;
+    return a2 / (PI * denominator * denominator);
+}
+
+void main()
+{
+    // assume the view direction is the reflection direction, the split sum approximation
+    vec3 N = normalize(WorldPos);
+    vec3 R = N;
+    vec3 V = R;
+
+    float saTexel = 4.0 * PI / (6.0 * resolution * resolution);
+    vec3 prefiltered = vec3(0.0);
+    float totalWeight = 0.0;
+    for(uint i = 0u; i < uint(sampleCount); ++i)
+    {
+        vec2 Xi = Hammersley(i, uint(sampleCount));
+        vec3 H = ImportanceSampleGGX(Xi, N, roughness);
+        vec3 L = normalize(2.0 * dot(V, H) * H - V);
+
+        float NdotL = dot(N, L);
+        if(NdotL > 0.0)
+        {
+            // sample a mip matching the solid angle this sample stands for, removes the bright speckles
+            float NdotH = max(dot(N, H), 0.0);
+            float HdotV = max(dot(H, V), 0.0);
+            float pdf = DistributionGGX(NdotH, roughness) * NdotH / (4.0 * HdotV) + 0.0001;
+            float saSample = 1.0 / (float(sampleCount) * pdf + 0.0001);
+            float mipLevel = roughness == 0.0 ? 0.0 : 0.5 * log2(saSample / saTexel);
+
+            prefiltered += textureLod(environmentMap, L, mipLevel).rgb * NdotL;
+            totalWeight += NdotL;
+        }
+    }
+    prefiltered = prefiltered / totalWeight;
+
+    FragColor = vec4(prefiltered, 1.0);
+}
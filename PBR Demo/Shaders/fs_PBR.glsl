@@ -1,120 +1,112 @@
 #version 400 core
+#ifdef BINDLESS_TEXTURES
+#extension GL_ARB_bindless_texture : require
+#endif
+// variants, see ShaderPermutations.h:
+//  BINDLESS_TEXTURES   material arrays read through resident handles, see MaterialLibrary.h
+//  GBUFFER             geometry pass of the deferred path: writes the surface out for fs_PBR-Deferred to light, see GBuffer.h
+//  DEPTH_ONLY          depth pre-pass: only depth is written, colour writes are masked off while it runs
+//  DERIVATIVE_TANGENTS the normal map's tangent frame comes from screen space derivatives of position and texture
+//                      coordinates, per fragment, instead of the tangents stored in the mesh
+
 // outputs
+#if defined(GBUFFER)
+layout (location = 0) out vec4 gAlbedoAO;       // albedo, ambient occlusion
+layout (location = 1) out vec4 gNormalMaterial; // octahedral normal, roughness, metallic
+#elif !defined(DEPTH_ONLY)
 out vec4 FragColor; // final fragment colour
+#endif
 
 // inputs
+#ifndef DEPTH_ONLY
 in vec3 Normal;     // surface normal
 in vec3 WorldPos;   // world position coordinates
 in vec2 TexCoords;  // texture coordiantes
+flat in uint MaterialIndex; // layer of this object's material in the map arrays
+#ifndef DERIVATIVE_TANGENTS
+in vec4 Tangent;    // world space, w: handedness
+#endif
+#endif
 
 // UNIFORMS (can be changed outside of shaders)
 //==========
-uniform vec3 viewPos;
-
-// pbr porperties
-uniform sampler2D metallicMap;
-uniform sampler2D roughnessMap;
-uniform sampler2D albedoMap;    // surface colour
-uniform sampler2D normalMap;    // surface imperfections
-uniform sampler2D aoMap;        // ambient occlusion
-
+#include "inc_FrameData.glsl"
 
-// lights
-uniform vec3 lightPos[4];
-uniform vec3 lightCol[4];
+// pbr porperties, one layer per material
+#ifdef BINDLESS_TEXTURES
+layout (std140) uniform MaterialTextures    // resident handles, see MaterialLibrary.h
+{
+    sampler2DArray albedoMap;
+    sampler2DArray normalMap;
+    sampler2DArray ormMap;
+};
+#else
+uniform sampler2DArray albedoMap;    // surface colour
+uniform sampler2DArray normalMap;    // surface imperfections
+uniform sampler2DArray ormMap;       // r = ambient occlusion, g = roughness, b = metallic
+#endif
 
-const float PI = 3.14159265359;
+#include "inc_Lighting.glsl"
+#include "inc_Octahedral.glsl"     // G-buffer normals
 
-// function prototypes
-vec3 FresnelFunc(float HdotV, vec3 F0);                        
-float NormDistributionFunc(vec3 N, vec3 H, float roughness);
-float GeometrySchlick(float NdotV, float roughness);
-float GeometryFunc(vec3 N, vec3 V, float roughness);
-vec3 getNormalMap();
+vec3 getNormalMap(vec3 materialCoords);
 
 void main()
 {      
+#ifndef DEPTH_ONLY
     // retrieve the material properties from the texture maps
-    float metallic = texture(metallicMap, TexCoords).r;     
-    float roughness = texture(roughnessMap, TexCoords).r;
-    vec3 albedo = pow(texture(albedoMap, TexCoords).rgb, vec3(2.2));
-    float ao = texture(aoMap, TexCoords).r;
-
-    vec3 normal = normalize(Normal);
-    vec3 viewDir = normalize(viewPos - WorldPos);
-
-    vec3 F0 = vec3(0.04);           // set to a constant 0.04 for dielectrics
-    F0 = mix(F0, albedo, metallic); // for metalic materials F0 is determined by the albedo and metalic properties
-
-    vec3 Lo = vec3(0.0);                        // total reflected radiance
-    for(int i = 0; i < 4; ++i) 
-    {
-        vec3 L = normalize(lightPos[i] - WorldPos);    // light direction
-        vec3 H = normalize(viewDir + L);            // half way vector
-
-        float dist = length(lightPos[i] - WorldPos);   // light ray distance
-        float attentuaiton = 1.0 / (dist * dist);   // use ligth distance to calculate fall off
-        vec3 radiance = lightCol[i] * attentuaiton;    // scale radiance based on attenuation
-
-        // BRDF
-        float NDF = NormDistributionFunc(normal, H, roughness);
-        float G = GeometryFunc(normal, viewDir, roughness);
-        vec3 F = FresnelFunc(max(dot(H, viewDir), 0.0), F0);
-
-        vec3 kS = F;                // reflected light (specular)
-        vec3 kD = vec3(1.0) - kS;   // refracted light (diffuse)
-        kD *= 1.0 - metallic;       // metalic surfaces dont refract light    
-
-        vec3 numerator = NDF * G * F;                           // calcualte DFG
-        float denominator = 4.0 * max(dot(normal, viewDir), 0.0) * max(dot(normal, L), 0.0);
-        vec3 specular = numerator / max(denominator, 0.001);    // work out the specular component using the BRDF
-
-        // Reflectance Equation
-        float NdotL = max(dot(normal, L), 0.0);
-        Lo += (kD * albedo / PI + specular) * radiance * NdotL; // calcualate final reflectance value
-    }
-    
-    vec3 ambient = vec3(0.03) * albedo * ao;    // make sure surfaces not in direct light are still lit
-    vec3 colour = ambient + Lo;                  
+    vec3 materialCoords = vec3(TexCoords, MaterialIndex);
+    vec3 albedo = texture(albedoMap, materialCoords).rgb;
+    vec3 orm = texture(ormMap, materialCoords).rgb;  // one fetch for all three
+    vec3 normal = getNormalMap(materialCoords);
+#ifdef GBUFFER
+    gAlbedoAO = vec4(albedo, orm.r);    // albedo is linearised when it is lit
+    gNormalMaterial = vec4(OctahedralEncode(normal) * 0.5 + 0.5, orm.g, orm.b);
+#else
+    albedo = pow(albedo, vec3(2.2));
+    float ao = orm.r;
+    float roughness = orm.g;
+    float metallic = orm.b;
+
+    vec3 viewDir = normalize(viewPos.xyz - WorldPos);
+
+    vec3 colour = shadeSurface(WorldPos, normal, viewDir, albedo, metallic, roughness, ao);
 
     colour = colour / (colour + vec3(1.0));     // tone map HDR values to LDR
     colour = pow(colour, vec3(1.0 / 2.2));      // gamma correction
 
     FragColor = vec4(colour, 1.0);
+#endif
+#endif
 }
 
 
 // FUNCTIONS
 //==========
-// calculate specular to diffuse reflection ratio
-vec3 FresnelFunc(float HdotV, vec3 F0)   
-{
-    return F0 + (1.0 - F0) * pow(max(1.0 - HdotV, 0.0), 5.0);
-}
-
-// Normal Distribution Function
-float NormDistributionFunc(vec3 N, vec3 H, float roughness)
+#ifndef DEPTH_ONLY
+// world space normal from the normal map. only x and y are read, z is rebuilt: a BC5 layer has no third channel
+vec3 getNormalMap(vec3 materialCoords)
 {
-    float numerator = roughness*roughness;                  // work out (a) squared
-    float NdotH = max(dot(N, H), 0.0);
-    float NdotH2 = NdotH * NdotH;                           // calculate (n dot h) squared
-
-    float denominator = (NdotH2 * (numerator - 1.0) + 1.0); 
-    denominator = PI * denominator * denominator;           // calculate the denominator
-
-    return numerator / max(denominator, 0.0000001);         // return NDF
+    vec2 xy = texture(normalMap, materialCoords).rg * 2.0 - 1.0;
+    vec3 tangentNormal = vec3(xy, sqrt(max(1.0 - dot(xy, xy), 0.0)));
+
+    vec3 N = normalize(Normal);
+#ifdef DERIVATIVE_TANGENTS
+    // how position and texture coordinates change across the pixel give dP/du and dP/dv. the determinant's
+    // sign is the mapping's orientation on screen, so mirrored uvs flip the frame like Tangent.w does
+    vec3 Q1 = dFdx(WorldPos);
+    vec3 Q2 = dFdy(WorldPos);
+    vec2 st1 = dFdx(TexCoords);
+    vec2 st2 = dFdy(TexCoords);
+    float orientation = st1.s * st2.t - st2.s * st1.t < 0.0 ? -1.0 : 1.0;
+    vec3 dPdu = (Q1 * st2.t - Q2 * st1.t) * orientation;
+    vec3 dPdv = (Q2 * st1.s - Q1 * st2.s) * orientation;
+    vec3 T = normalize(dPdu - N * dot(N, dPdu));
+    vec3 B = (dot(cross(N, T), dPdv) > 0.0 ? -1.0 : 1.0) * cross(N, T);    // up the image, against dP/dv: the maps are loaded top row first
+#else
+    vec3 T = normalize(Tangent.xyz - N * dot(N, Tangent.xyz));  // interpolation leaves it a little off perpendicular
+    vec3 B = Tangent.w * cross(N, T);
+#endif
+    return normalize(mat3(T, B, N) * tangentNormal);
 }
-
-// Geometry Function
-float GeometryFunc(vec3 N, vec3 V, float roughness)
-{
-    float NdotV = max(dot(N, V), 0.0);  // calculate n dot v (return 0 if dot product is less than 0)
-
-    float r = roughness + 1.0;
-    float k = (r * r) / 8.0;            // calculate k for direct ligting
-
-    float numerator = NdotV;
-    float denominator = NdotV * (1.0 - k) + k;
-
-    return numerator / denominator;
-}
\ No newline at end of file
+#endif
\ No newline at end of file
@@ -0,0 +1,52 @@
+#ifndef INC_BRDF_GLSL
+#define INC_BRDF_GLSL
+
+// Cook-Torrance specular BRDF terms, shared by everything that shades a surface
+
+const float PI = 3.14159265359;
+
+// calculate specular to diffuse reflection ratio
+vec3 FresnelFunc(float HdotV, vec3 F0)
+{
+    return F0 + (1.0 - F0) * pow(max(1.0 - HdotV, 0.0), 5.0);
+}
+
+// fresnel for ambient light, rough surfaces reflect less of the environment at grazing angles
+vec3 FresnelRoughnessFunc(float NdotV, vec3 F0, float roughness)
+{
+    return F0 + (max(vec3(1.0 - roughness), F0) - F0) * pow(max(1.0 - NdotV, 0.0), 5.0);
+}
+
+// Normal Distribution Function
+float NormDistributionFunc(vec3 N, vec3 H, float roughness)
+{
+    float numerator = roughness*roughness;                  // work out (a) squared
+    float NdotH = max(dot(N, H), 0.0);
+    float NdotH2 = NdotH * NdotH;                           // calculate (n dot h) squared
+
+    float denominator = (NdotH2 * (numerator - 1.0) + 1.0);
+    denominator = PI * denominator * denominator;           // calculate the denominator
+
+    return numerator / max(denominator, 0.0000001);         // return NDF
+}
+
+// Schlick-GGX with k for direct lighting
+float GeometrySchlick(float NdotV, float roughness)
+{
+    float r = roughness + 1.0;
+    float k = (r * r) / 8.0;            // calculate k for direct ligting
+
+    float numerator = NdotV;
+    float denominator = NdotV * (1.0 - k) + k;
+
+    return numerator / denominator;
+}
+
+// Geometry Function
+float GeometryFunc(vec3 N, vec3 V, float roughness)
+{
+    float NdotV = max(dot(N, V), 0.0);  // calculate n dot v (return 0 if dot product is less than 0)
+    return GeometrySchlick(NdotV, roughness);
+}
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef INC_CLUSTERS_GLSL
+#define INC_CLUSTERS_GLSL
+
+// point lights binned into clusters, see LightClusters.h
+#include "inc_FrameData.glsl"
+
+uniform samplerBuffer lightData;        // per light: position + radius, colour
+uniform usamplerBuffer clusterLights;   // per cluster: first index, count
+uniform usamplerBuffer lightIndices;    // every cluster's light list back to back
+
+// cluster of a fragment at worldPos: its screen tile and the exponential depth slice it falls in
+int getCluster(vec3 worldPos)
+{
+    float depth = -(view * vec4(worldPos, 1.0)).z;
+    uvec2 tile = min(uvec2(gl_FragCoord.xy * clusterScale.xy), clusterGrid.xy - 1u);
+    uint slice = uint(clamp(log(depth) * clusterScale.z - clusterScale.w, 0.0, float(clusterGrid.z - 1u)));
+    return int((slice * clusterGrid.y + tile.y) * clusterGrid.x + tile.x);
+}
+
+#endif
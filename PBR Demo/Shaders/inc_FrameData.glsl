@@ -0,0 +1,15 @@
+#ifndef INC_FRAMEDATA_GLSL
+#define INC_FRAMEDATA_GLSL
+
+// per-frame data shared by every program, see FrameUniforms.h
+layout (std140) uniform FrameData
+{
+    mat4 projection;
+    mat4 view;
+    vec4 viewPos;
+    uvec4 clusterGrid;
+    vec4 clusterScale;
+    mat4 inverseViewProjection;
+};
+
+#endif
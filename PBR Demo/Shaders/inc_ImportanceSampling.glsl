@@ -0,0 +1,30 @@
+#ifndef INC_IMPORTANCESAMPLING_GLSL
+#define INC_IMPORTANCESAMPLING_GLSL
+
+// GGX importance sampling for the image based lighting precompute, see IBL.h
+#include "inc_BRDF.glsl"
+
+// low discrepancy sequence, spreads the samples evenly over the lobe
+vec2 Hammersley(uint i, uint N)
+{
+    return vec2(float(i) / float(N), float(bitfieldReverse(i)) * 2.3283064365386963e-10);
+}
+
+// GGX distributed half vector around N
+vec3 ImportanceSampleGGX(vec2 Xi, vec3 N, float roughness)
+{
+    float a = roughness * roughness;
+
+    float phi = 2.0 * PI * Xi.x;
+    float cosTheta = sqrt((1.0 - Xi.y) / (1.0 + (a * a - 1.0) * Xi.y));
+    float sinTheta = sqrt(1.0 - cosTheta * cosTheta);
+    vec3 H = vec3(cos(phi) * sinTheta, sin(phi) * sinTheta, cosTheta);
+
+    vec3 up = abs(N.z) < 0.999 ? vec3(0.0, 0.0, 1.0) : vec3(1.0, 0.0, 0.0);
+    vec3 tangent = normalize(cross(up, N));
+    vec3 bitangent = cross(N, tangent);
+
+    return normalize(tangent * H.x + bitangent * H.y + N * H.z);
+}
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef INC_LIGHTING_GLSL
+#define INC_LIGHTING_GLSL
+
+// the surface lighting every shading path shares: the clustered point lights plus image based ambient light
+#include "inc_Clusters.glsl"
+#include "inc_BRDF.glsl"
+
+// image based lighting, see IBL.h
+uniform samplerCube irradianceMap;  // diffuse
+uniform samplerCube prefilterMap;   // specular, one roughness per mip
+uniform sampler2D brdfLUT;          // split sum scale and bias for F0
+uniform float prefilterMaxLod;      // mip holding roughness 1
+
+// radiance leaving a surface at P towards the viewer, HDR and linear. N and V are unit length, V points at the viewer
+vec3 shadeSurface(vec3 P, vec3 N, vec3 V, vec3 albedo, float metallic, float roughness, float ao)
+{
+    vec3 F0 = vec3(0.04);           // set to a constant 0.04 for dielectrics
+    F0 = mix(F0, albedo, metallic); // for metalic materials F0 is determined by the albedo and metalic properties
+
+    vec3 Lo = vec3(0.0);                        // total reflected radiance
+    uvec2 cluster = texelFetch(clusterLights, getCluster(P)).rg;    // only the lights that reach this cluster
+    for(uint i = 0u; i < cluster.y; ++i) 
+    {
+        int light = int(texelFetch(lightIndices, int(cluster.x + i)).r);
+        vec4 lightPos = texelFetch(lightData, light * 2);       // xyz position, w radius
+        vec3 lightCol = texelFetch(lightData, light * 2 + 1).rgb;
+
+        vec3 L = normalize(lightPos.xyz - P);   // light direction
+        vec3 H = normalize(V + L);              // half way vector
+
+        float dist = length(lightPos.xyz - P);  // light ray distance
+        float window = clamp(1.0 - pow(dist / lightPos.w, 4.0), 0.0, 1.0);   // fades to zero at the light's radius
+        float attentuaiton = window * window / (dist * dist);   // use ligth distance to calculate fall off
+        vec3 radiance = lightCol * attentuaiton;    // scale radiance based on attenuation
+
+        // BRDF
+        float NDF = NormDistributionFunc(N, H, roughness);
+        float G = GeometryFunc(N, V, roughness);
+        vec3 F = FresnelFunc(max(dot(H, V), 0.0), F0);
+
+        vec3 kS = F;                // reflected light (specular)
+        vec3 kD = vec3(1.0) - kS;   // refracted light (diffuse)
+        kD *= 1.0 - metallic;       // metalic surfaces dont refract light    
+
+        vec3 numerator = NDF * G * F;                           // calcualte DFG
+        float denominator = 4.0 * max(dot(N, V), 0.0) * max(dot(N, L), 0.0);
+        vec3 specular = numerator / max(denominator, 0.001);    // work out the specular component using the BRDF
+
+        // Reflectance Equation
+        float NdotL = max(dot(N, L), 0.0);
+        Lo += (kD * albedo / PI + specular) * radiance * NdotL; // calcualate final reflectance value
+    }
+    
+    // ambient lighting from the environment (split sum approximation)
+    float NdotV = max(dot(N, V), 0.0);
+    vec3 F = FresnelRoughnessFunc(NdotV, F0, roughness);
+    vec3 kD = (vec3(1.0) - F) * (1.0 - metallic);
+
+    vec3 irradiance = texture(irradianceMap, N).rgb;
+    vec3 diffuse = irradiance * albedo;
+
+    vec3 R = reflect(-V, N);
+    vec3 prefiltered = textureLod(prefilterMap, R, roughness * prefilterMaxLod).rgb;
+    vec2 envBRDF = texture(brdfLUT, vec2(NdotV, roughness)).rg;
+    vec3 specular = prefiltered * (F * envBRDF.x + envBRDF.y);
+
+    vec3 ambient = (kD * diffuse + specular) * ao;
+    return ambient + Lo;
+}
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef INC_OCTAHEDRAL_GLSL
+#define INC_OCTAHEDRAL_GLSL
+
+// unit vectors in two channels instead of three: folded onto the octahedron, then flattened to [-1, 1]^2.
+// the built in meshes' normals and the deferred path's G-buffer normals are packed this way
+
+vec2 OctahedralEncode(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 signs = vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return n.z >= 0.0 ? n.xy : (1.0 - abs(n.yx)) * signs;
+}
+
+vec3 OctahedralDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+    {
+        vec2 signs = vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+        n.xy = (1.0 - abs(n.yx)) * signs;
+    }
+    return normalize(n);
+}
+
+#endif
@@ -1,21 +1,41 @@
 #version 400 core
-layout (location = 0) in vec3 aPos;
+// variants, see ShaderPermutations.h:
+//  DEPTH_ONLY              depth pre-pass, position only
+//  DERIVATIVE_TANGENTS     fs_PBR builds the normal map's tangent frame itself, the vertex tangent isn't passed on
+layout (location = 0) in vec4 aPos;         // w: tangent handedness
 layout (location = 1) in vec2 aTexCoords;
-layout (location = 2) in vec3 aNormal;
+layout (location = 2) in vec2 aNormal;      // octahedral, see Primitives.cpp
+layout (location = 3) in mat4 aModel;       // per instance (locations 3-6)
+layout (location = 7) in uint aMaterial;    // per instance, layer in the material texture arrays
+layout (location = 8) in vec2 aTangent;     // octahedral, along increasing u
 
+#ifndef DEPTH_ONLY
 out vec2 TexCoords;
 out vec3 WorldPos;
 out vec3 Normal;
+flat out uint MaterialIndex;
+#ifndef DERIVATIVE_TANGENTS
+out vec4 Tangent;           // w: handedness, the bitangent is w * cross(Normal, Tangent)
+#endif
+#endif
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+invariant gl_Position;      // the same in every variant, the colour pass after a depth pre-pass tests with GL_EQUAL
+
+#include "inc_FrameData.glsl"
+#include "inc_Octahedral.glsl"     // aNormal
 
 void main()
 {
-	TexCoords = aTexCoords;
-	WorldPos = vec3(model * vec4(aPos, 1.0));
-	Normal = mat3(model) * aNormal; 
+	vec3 worldPos = vec3(aModel * vec4(aPos.xyz, 1.0));
+	gl_Position = projection * view * vec4(worldPos, 1.0);
 
-	gl_Position = projection * view * vec4(WorldPos, 1.0);
-}
\ No newline at end of file
+#ifndef DEPTH_ONLY
+	TexCoords = aTexCoords;
+	MaterialIndex = aMaterial;
+	WorldPos = worldPos;
+	Normal = mat3(aModel) * OctahedralDecode(aNormal);
+#ifndef DERIVATIVE_TANGENTS
+	Tangent = vec4(mat3(aModel) * OctahedralDecode(aTangent), aPos.w);
+#endif
+#endif
+}
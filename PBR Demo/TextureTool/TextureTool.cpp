@@ -0,0 +1,287 @@
+// TEXTURE TOOL
+//=============
+// Offline packer for the demo's material sets. For every set it reads the PNG maps and writes block
+// compressed DDS files with their whole mip chain next to them, which the demo uploads as they are:
+//
+//	<set>_albedo.png								-> <set>_albedo.dds	BC7
+//	<set>_normal.png								-> <set>_normal.dds	BC5, x and y only
+//	<set>_ao.png, _roughness.png, _metallic.png		-> <set>_orm.dds	BC7, r = ao, g = roughness, b = metallic
+//
+// usage: TextureTool [--max-size N] <textures directory> <set name> [<set name> ...]
+// Missing maps are filled with the same neutral values the demo shows while textures stream in.
+
+#include <TextureCompression.h>
+#include <stb_image.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+
+struct Image
+{
+	int width = 0, height = 0;
+	std::vector<unsigned char> rgba;
+};
+
+// 8 bit RGBA, or an empty image if the file is missing
+static Image loadImage(const std::string& path)
+{
+	Image image;
+	int components;
+	unsigned char* data = stbi_load(path.c_str(), &image.width, &image.height, &components, 4);
+	if (data)
+	{
+		image.rgba.assign(data, data + (std::size_t)image.width * image.height * 4);
+		stbi_image_free(data);
+	}
+	else
+	{
+		image.width = image.height = 0;
+	}
+	return image;
+}
+
+static Image solidImage(int width, int height, const unsigned char colour[4])
+{
+	Image image;
+	image.width = width;
+	image.height = height;
+	image.rgba.resize((std::size_t)width * height * 4);
+	for (std::size_t i = 0; i < image.rgba.size(); i += 4)
+	{
+		memcpy(&image.rgba[i], colour, 4);
+	}
+	return image;
+}
+
+// nearest neighbour, only used to line the ORM sources up when they differ in size
+static Image resizeNearest(const Image& source, int width, int height)
+{
+	Image image;
+	image.width = width;
+	image.height = height;
+	image.rgba.resize((std::size_t)width * height * 4);
+	for (int y = 0; y < height; ++y)
+	{
+		for (int x = 0; x < width; ++x)
+		{
+			int sx = x * source.width / width;
+			int sy = y * source.height / height;
+			memcpy(&image.rgba[((std::size_t)y * width + x) * 4], &source.rgba[((std::size_t)sy * source.width + sx) * 4], 4);
+		}
+	}
+	return image;
+}
+
+// 2x2 box filter. normals are averaged as vectors and renormalised so rough mips don't flatten out
+static Image downsample(const Image& source, bool normalMap)
+{
+	Image image;
+	image.width = std::max(1, source.width / 2);
+	image.height = std::max(1, source.height / 2);
+	image.rgba.resize((std::size_t)image.width * image.height * 4);
+
+	for (int y = 0; y < image.height; ++y)
+	{
+		for (int x = 0; x < image.width; ++x)
+		{
+			float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			for (int i = 0; i < 4; ++i)
+			{
+				int sx = std::min(x * 2 + (i & 1), source.width - 1);
+				int sy = std::min(y * 2 + (i >> 1), source.height - 1);
+				const unsigned char* texel = &source.rgba[((std::size_t)sy * source.width + sx) * 4];
+				for (int c = 0; c < 4; ++c)
+				{
+					sum[c] += texel[c];
+				}
+			}
+
+			unsigned char* texel = &image.rgba[((std::size_t)y * image.width + x) * 4];
+			if (normalMap)
+			{
+				float n[3];
+				for (int c = 0; c < 3; ++c)
+				{
+					n[c] = sum[c] / (4.0f * 127.5f) - 1.0f;
+				}
+				float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+				for (int c = 0; c < 3; ++c)
+				{
+					float value = length > 0.0f ? n[c] / length : (c == 2 ? 1.0f : 0.0f);
+					texel[c] = (unsigned char)std::min(std::max((value + 1.0f) * 127.5f + 0.5f, 0.0f), 255.0f);
+				}
+				texel[3] = (unsigned char)(sum[3] / 4.0f + 0.5f);
+			}
+			else
+			{
+				for (int c = 0; c < 4; ++c)
+				{
+					texel[c] = (unsigned char)(sum[c] / 4.0f + 0.5f);
+				}
+			}
+		}
+	}
+	return image;
+}
+
+// peak signal to noise ratio of the top mip over the channels the format keeps
+static double measurePSNR(const Image& source, const CompressedImage& compressed)
+{
+	std::vector<unsigned char> decoded((std::size_t)source.width * source.height * 4);
+	decompressImage(compressed.format, &compressed.levels[0][0], source.width, source.height, &decoded[0]);
+
+	int channels = compressed.format == BLOCK_FORMAT_BC5 ? 2 : 4;
+	double error = 0.0;
+	for (std::size_t i = 0; i < decoded.size(); i += 4)
+	{
+		for (int c = 0; c < channels; ++c)
+		{
+			double difference = (double)decoded[i + c] - source.rgba[i + c];
+			error += difference * difference;
+		}
+	}
+	error /= (double)source.width * source.height * channels;
+	return error > 0.0 ? 10.0 * log10(255.0 * 255.0 / error) : 99.0;
+}
+
+static bool writeCompressed(const std::string& path, Image image, BlockFormat format, bool normalMap, int maxSize)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	while (maxSize > 0 && std::max(image.width, image.height) > maxSize)
+	{
+		image = downsample(image, normalMap);
+	}
+
+	CompressedImage compressed;
+	compressed.format = format;
+	compressed.width = image.width;
+	compressed.height = image.height;
+
+	Image level = image;
+	for (;;)
+	{
+		compressed.levels.push_back(std::vector<unsigned char>(compressedSize(level.width, level.height)));
+		compressImage(format, &level.rgba[0], level.width, level.height, &compressed.levels.back()[0]);
+		if (level.width == 1 && level.height == 1)
+		{
+			break;
+		}
+		level = downsample(level, normalMap);
+	}
+
+	bool written = writeDDS(path, compressed);
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::size_t bytes = 0;
+	for (std::size_t i = 0; i < compressed.levels.size(); ++i)
+	{
+		bytes += compressed.levels[i].size();
+	}
+	std::cout << (written ? "" : "FAILED ") << path << ": " << image.width << "x" << image.height << " " << (format == BLOCK_FORMAT_BC7 ? "BC7" : "BC5")
+		<< ", " << compressed.levels.size() << " mips, " << bytes / 1024 << " KB, " << measurePSNR(image, compressed) << " dB, " << seconds << " s" << std::endl;
+	return written;
+}
+
+static bool packSet(const std::string& directory, const std::string& setName, int maxSize)
+{
+	std::string base = directory + "/" + setName + "/" + setName + "_";
+	const unsigned char albedoDefault[4] = { 128, 128, 128, 255 };
+	const unsigned char normalDefault[4] = { 128, 128, 255, 255 };
+	const unsigned char ormDefault[4] = { 255, 128, 0, 255 };	// unoccluded, half rough, dielectric
+
+	Image albedo = loadImage(base + "albedo.png");
+	Image normal = loadImage(base + "normal.png");
+	Image orm[3] = { loadImage(base + "ao.png"), loadImage(base + "roughness.png"), loadImage(base + "metallic.png") };
+
+	// the largest map decides the size of anything that has to be made up
+	int size = 4;
+	size = std::max(size, std::max(albedo.width, normal.width));
+	for (int i = 0; i < 3; ++i)
+	{
+		size = std::max(size, orm[i].width);
+	}
+
+	if (albedo.width == 0)
+	{
+		std::cout << "missing " << base << "albedo.png, using grey" << std::endl;
+		albedo = solidImage(size, size, albedoDefault);
+	}
+	if (normal.width == 0)
+	{
+		std::cout << "missing " << base << "normal.png, using flat" << std::endl;
+		normal = solidImage(size, size, normalDefault);
+	}
+
+	// pack the single channel maps, each one's red channel into its slot
+	int ormWidth = 0, ormHeight = 0;
+	for (int i = 0; i < 3; ++i)
+	{
+		ormWidth = std::max(ormWidth, orm[i].width);
+		ormHeight = std::max(ormHeight, orm[i].height);
+	}
+	if (ormWidth == 0)
+	{
+		ormWidth = ormHeight = size;
+	}
+	Image packed = solidImage(ormWidth, ormHeight, ormDefault);
+	const char* ormNames[3] = { "ao", "roughness", "metallic" };
+	for (int i = 0; i < 3; ++i)
+	{
+		if (orm[i].width == 0)
+		{
+			std::cout << "missing " << base << ormNames[i] << ".png, using " << (int)ormDefault[i] << std::endl;
+			continue;
+		}
+		if (orm[i].width != ormWidth || orm[i].height != ormHeight)
+		{
+			orm[i] = resizeNearest(orm[i], ormWidth, ormHeight);
+		}
+		for (std::size_t texel = 0; texel < packed.rgba.size(); texel += 4)
+		{
+			packed.rgba[texel + i] = orm[i].rgba[texel];
+		}
+	}
+
+	bool written = writeCompressed(base + "albedo.dds", albedo, BLOCK_FORMAT_BC7, false, maxSize);
+	written &= writeCompressed(base + "normal.dds", normal, BLOCK_FORMAT_BC5, true, maxSize);
+	written &= writeCompressed(base + "orm.dds", packed, BLOCK_FORMAT_BC7, false, maxSize);
+	return written;
+}
+
+int main(int argc, char** argv)
+{
+	int maxSize = 0;
+	std::vector<std::string> arguments;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--max-size") == 0 && i + 1 < argc)
+		{
+			maxSize = atoi(argv[++i]);
+		}
+		else
+		{
+			arguments.push_back(argv[i]);
+		}
+	}
+
+	if (arguments.size() < 2)
+	{
+		std::cout << "usage: TextureTool [--max-size N] <textures directory> <set name> [<set name> ...]" << std::endl;
+		return 1;
+	}
+
+	bool succeeded = true;
+	for (std::size_t i = 1; i < arguments.size(); ++i)
+	{
+		succeeded &= packSet(arguments[0], arguments[i], maxSize);
+	}
+	return succeeded ? 0 : 1;
+}